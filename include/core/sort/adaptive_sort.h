@@ -0,0 +1,221 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "frame.h"
+#include "key.h"
+
+namespace core::sort {
+
+namespace adaptive_detail {
+
+struct Run {
+    size_t begin, end;
+    int power{};
+};
+
+// Return the first index in [begin, end) for which `pred` is false
+// where `pred` is true for a prefix of the range. The search gallops
+// forward from `begin` so short prefixes are found in O(log k).
+template<class Pred>
+size_t gallop(size_t begin, size_t end, Pred pred) {
+    if (begin == end or not pred(begin))
+	return begin;
+
+    size_t lo = begin, hi = begin + 1, step = 1;
+    while (hi < end and pred(hi)) {
+	lo = hi;
+	step *= 2;
+	hi = std::min(end, lo + step);
+    }
+
+    ++lo;
+    while (lo < hi) {
+	auto mid = lo + (hi - lo) / 2;
+	if (pred(mid)) lo = mid + 1;
+	else hi = mid;
+    }
+    return lo;
+}
+
+// Insert the rows [sorted_end, end) into the sorted rows [begin,
+// sorted_end) using binary search. Equal rows keep their order.
+void binary_insertion_sort(Frame& frame, const Keys& keys, size_t begin,
+			   size_t sorted_end, size_t end) {
+    const auto bpr = frame.bytes_per_row();
+    std::vector<uint8_t> tmp(bpr);
+    for (auto jdx = sorted_end; jdx < end; ++jdx) {
+	auto lo = begin, hi = jdx;
+	while (lo < hi) {
+	    auto mid = lo + (hi - lo) / 2;
+	    if (compare(frame.row(jdx), frame.row(mid), keys)) hi = mid;
+	    else lo = mid + 1;
+	}
+	if (lo == jdx)
+	    continue;
+	std::copy(frame.row(jdx), frame.row(jdx + 1), tmp.data());
+	std::copy_backward(frame.row(lo), frame.row(jdx), frame.row(jdx + 1));
+	std::copy(tmp.begin(), tmp.end(), frame.row(lo));
+    }
+}
+
+// Return the natural run starting at `begin`. A strictly descending
+// run is reversed in place (strictly so that equal rows stay in
+// order). Runs shorter than `min_run` are extended with binary
+// insertion sort.
+Run next_run(Frame& frame, const Keys& keys, size_t begin, size_t min_run) {
+    const auto n = frame.nrows();
+    auto end = begin + 1;
+    if (end < n and compare(frame.row(end), frame.row(begin), keys)) {
+	while (end + 1 < n and compare(frame.row(end + 1), frame.row(end), keys))
+	    ++end;
+	++end;
+	for (auto ldx = begin, rdx = end - 1; ldx < rdx; ++ldx, --rdx)
+	    frame.swap_rows(ldx, rdx);
+    } else {
+	while (end < n and not compare(frame.row(end), frame.row(end - 1), keys))
+	    ++end;
+    }
+
+    if (end - begin < min_run) {
+	auto extended = std::min(n, begin + min_run);
+	binary_insertion_sort(frame, keys, begin, end, extended);
+	end = extended;
+    }
+    return {begin, end};
+}
+
+// Return the powersort node power of the boundary between the runs
+// [begin, begin + n1) and [begin + n1, begin + n1 + n2) of `n` rows.
+int node_power(size_t begin, size_t n1, size_t n2, size_t n) {
+    auto a = 2 * begin + n1, b = a + n1 + n2;
+    int power{};
+    while (true) {
+	++power;
+	if (a >= n) {
+	    a -= n;
+	    b -= n;
+	} else if (b >= n) {
+	    break;
+	}
+	a <<= 1;
+	b <<= 1;
+    }
+    return power;
+}
+
+// Stable merge of the adjacent sorted rows [lo, mid) and [mid, hi).
+// Rows already in place at either end are skipped by galloping, the
+// remaining left rows are copied to `buffer` and merged forward. After
+// `MinGallop` consecutive wins by one side, the merge switches to
+// galloping to copy whole blocks from that side.
+void merge_runs(Frame& frame, const Keys& keys, size_t lo, size_t mid, size_t hi,
+		std::vector<uint8_t>& buffer) {
+    constexpr size_t MinGallop = 7;
+    const auto bpr = frame.bytes_per_row();
+
+    lo = gallop(lo, mid, [&](size_t idx) {
+	return not compare(frame.row(mid), frame.row(idx), keys);
+    });
+    hi = gallop(mid, hi, [&](size_t idx) {
+	return compare(frame.row(idx), frame.row(mid - 1), keys);
+    });
+    if (lo == mid or mid == hi)
+	return;
+
+    buffer.resize((mid - lo) * bpr);
+    std::copy(frame.row(lo), frame.row(mid), buffer.data());
+    auto left = [&](size_t idx) { return buffer.data() + idx * bpr; };
+
+    size_t ldx = 0, lend = mid - lo, rdx = mid;
+    auto out = frame.row(lo);
+    auto take_left = [&](size_t count) {
+	out = std::copy(left(ldx), left(ldx + count), out);
+	ldx += count;
+    };
+    auto take_right = [&](size_t count) {
+	out = std::copy(frame.row(rdx), frame.row(rdx + count), out);
+	rdx += count;
+    };
+
+    while (ldx < lend and rdx < hi) {
+	size_t lwins{}, rwins{};
+	while (ldx < lend and rdx < hi and lwins < MinGallop and rwins < MinGallop) {
+	    if (compare(frame.row(rdx), left(ldx), keys)) {
+		take_right(1);
+		++rwins;
+		lwins = 0;
+	    } else {
+		take_left(1);
+		++lwins;
+		rwins = 0;
+	    }
+	}
+
+	while (ldx < lend and rdx < hi) {
+	    auto nleft = gallop(ldx, lend, [&](size_t idx) {
+		return not compare(frame.row(rdx), left(idx), keys);
+	    }) - ldx;
+	    take_left(nleft);
+	    if (ldx == lend)
+		break;
+	    take_right(1);
+	    if (rdx == hi)
+		break;
+
+	    auto nright = gallop(rdx, hi, [&](size_t idx) {
+		return compare(frame.row(idx), left(ldx), keys);
+	    }) - rdx;
+	    take_right(nright);
+	    if (rdx == hi)
+		break;
+	    take_left(1);
+
+	    if (nleft < MinGallop and nright < MinGallop)
+		break;
+	}
+    }
+    take_left(lend - ldx);
+}
+
+}; // adaptive_detail
+
+// Stable adaptive merge sort (powersort). The frame is scanned for
+// natural ascending and strictly descending runs, descending runs are
+// reversed, short runs are extended to `MinRun` rows and the runs are
+// merged using the powersort merge policy. Sorted input is detected in
+// a single pass of n - 1 comparisons.
+void adaptive_sort(Frame& frame, const Keys& sort_keys) {
+    using namespace adaptive_detail;
+    constexpr size_t MinRun = 32;
+    const auto n = frame.nrows();
+    if (n < 2)
+	return;
+
+    auto keys = bind_heap(frame, sort_keys);
+
+    std::vector<uint8_t> buffer;
+    std::vector<Run> stack;
+    auto run = next_run(frame, keys, 0, MinRun);
+    while (run.end < n) {
+	auto next = next_run(frame, keys, run.end, MinRun);
+	auto power = node_power(run.begin, run.end - run.begin, next.end - next.begin, n);
+	while (not stack.empty() and stack.back().power > power) {
+	    merge_runs(frame, keys, stack.back().begin, run.begin, run.end, buffer);
+	    run.begin = stack.back().begin;
+	    stack.pop_back();
+	}
+	stack.push_back({run.begin, run.end, power});
+	run = next;
+    }
+
+    while (not stack.empty()) {
+	merge_runs(frame, keys, stack.back().begin, run.begin, run.end, buffer);
+	run.begin = stack.back().begin;
+	stack.pop_back();
+    }
+}
+
+}; // core::sort
@@ -0,0 +1,188 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace core::sort {
+
+// An allocator that default-initializes (i.e. leaves uninitialized)
+// trivial elements instead of value-initializing them. A `Frame` that
+// is not explicitly initialized then costs neither a zero-fill pass
+// nor a page fault until its rows are first written.
+template<class T>
+struct DefaultInitAllocator : std::allocator<T> {
+    using std::allocator<T>::allocator;
+
+    template<class U>
+    struct rebind {
+	using other = DefaultInitAllocator<U>;
+    };
+
+    template<class U, class... Args>
+    void construct(U *ptr, Args&&... args) {
+	if constexpr (sizeof...(Args) == 0)
+	    ::new(static_cast<void*>(ptr)) U;
+	else
+	    ::new(static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+};
+
+// A `DefaultInitAllocator` whose allocations are aligned to `Align`
+// bytes, by default a cache line.
+template<class T, size_t Align = 64>
+struct AlignedAllocator : DefaultInitAllocator<T> {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {
+    }
+
+    template<class U>
+    struct rebind {
+	using other = AlignedAllocator<U, Align>;
+    };
+
+    T *allocate(size_t n) {
+	return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Align}));
+    }
+
+    void deallocate(T *ptr, size_t) {
+	::operator delete(ptr, std::align_val_t{Align});
+    }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U, Align>&) const {
+	return true;
+    }
+};
+
+// Default     -- The global heap.
+// Transparent -- Allocations of at least one huge page are mapped
+//                aligned to the huge page size and advised to use
+//                transparent huge pages.
+// Explicit    -- As Transparent, but first try the reserved huge page
+//                pool with MAP_HUGETLB.
+enum class PagePolicy { Default, Transparent, Explicit };
+
+namespace allocator_detail {
+
+inline constexpr size_t HugePageSize = size_t{1} << 21;
+
+inline size_t huge_length(size_t nbytes) {
+    return (nbytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+}
+
+// Map `nbytes` aligned to the huge page size, or return nullptr.
+inline void *map_huge(size_t nbytes, PagePolicy policy) {
+#ifdef __linux__
+    const auto length = huge_length(nbytes);
+#ifdef MAP_HUGETLB
+    if (policy == PagePolicy::Explicit) {
+	auto *ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (ptr != MAP_FAILED)
+	    return ptr;
+    }
+#endif
+    auto *ptr = ::mmap(nullptr, length + HugePageSize, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+	return nullptr;
+    auto addr = reinterpret_cast<uintptr_t>(ptr);
+    auto aligned = (addr + HugePageSize - 1) / HugePageSize * HugePageSize;
+    if (aligned > addr)
+	::munmap(ptr, aligned - addr);
+    if (auto tail = addr + HugePageSize - aligned; tail > 0)
+	::munmap(reinterpret_cast<void*>(aligned + length), tail);
+#ifdef MADV_HUGEPAGE
+    ::madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void*>(aligned);
+#else
+    return nullptr;
+#endif
+}
+
+inline void unmap_huge(void *ptr, size_t nbytes) {
+#ifdef __linux__
+    ::munmap(ptr, huge_length(nbytes));
+#endif
+}
+
+}; // allocator_detail
+
+// A `DefaultInitAllocator` that places allocations of at least one
+// huge page according to a `PagePolicy`. Smaller allocations, and all
+// allocations with the Default policy or on systems without mmap, come
+// from the global heap aligned to a cache line. The pages are not
+// touched, so they are placed on the NUMA node of the thread that
+// first writes them. The policy travels with the memory on copy, move
+// and swap.
+template<class T>
+struct PageAllocator : DefaultInitAllocator<T> {
+    using value_type = T;
+    using is_always_equal = std::false_type;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PageAllocator(PagePolicy policy = PagePolicy::Default)
+	: policy_(policy) {
+    }
+
+    template<class U>
+    PageAllocator(const PageAllocator<U>& other)
+	: policy_(other.policy()) {
+    }
+
+    template<class U>
+    struct rebind {
+	using other = PageAllocator<U>;
+    };
+
+    PagePolicy policy() const {
+	return policy_;
+    }
+
+    T *allocate(size_t n) {
+	if (huge(n)) {
+	    auto *ptr = allocator_detail::map_huge(n * sizeof(T), policy_);
+	    if (not ptr)
+		throw std::bad_alloc{};
+	    return static_cast<T*>(ptr);
+	}
+	return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{64}));
+    }
+
+    void deallocate(T *ptr, size_t n) {
+	if (huge(n)) allocator_detail::unmap_huge(ptr, n * sizeof(T));
+	else ::operator delete(ptr, std::align_val_t{64});
+    }
+
+    template<class U>
+    bool operator==(const PageAllocator<U>& other) const {
+	return policy_ == other.policy();
+    }
+
+private:
+    bool huge(size_t n) const {
+#ifdef __linux__
+	return policy_ != PagePolicy::Default and n * sizeof(T) >= allocator_detail::HugePageSize;
+#else
+	return false;
+#endif
+    }
+
+    PagePolicy policy_;
+};
+
+}; // core::sort
@@ -3,30 +3,45 @@
 
 #pragma once
 #include <algorithm>
+#include <array>
+#include <bit>
 
 namespace core::sort {
 
+// A ring of `Size` elements addressed by ever increasing head and tail
+// indices. Indices are reduced with a mask when `Size` is a power of
+// two. The head and tail are on separate cache lines so a producer
+// advancing one does not invalidate the line of a consumer advancing
+// the other.
 template<class T, size_t Size, size_t Align>
 class ArrayRing {
 public:
+    static constexpr size_t IndexAlign = 64;
+
+    static constexpr size_t slot(size_t idx) {
+	if constexpr (std::has_single_bit(Size)) return idx & (Size - 1);
+	else return idx % Size;
+    }
+
     auto size() const { return head_ - tail_; }
-    auto& next() { return data_[head_ % Size]; }
-    auto& front() { return data_[tail_ % Size]; }
-    const auto& front() const { return data_[tail_ % Size]; }
-    auto& back() { return data_[(head_ + Size - 1) % Size]; }
-    const auto& back() const { return data_[(head_ + Size - 1) % Size]; }
+    auto& operator[](size_t idx) { return data_[slot(idx)]; }
+    const auto& operator[](size_t idx) const { return data_[slot(idx)]; }
+    auto& next() { return data_[slot(head_)]; }
+    auto& front() { return data_[slot(tail_)]; }
+    const auto& front() const { return data_[slot(tail_)]; }
+    auto& back() { return data_[slot(head_ + Size - 1)]; }
+    const auto& back() const { return data_[slot(head_ + Size - 1)]; }
     auto& head_index() { return head_; }
     const auto& head_index() const { return head_; }
     auto& tail_index() { return tail_; }
     const auto& tail_index() const { return tail_; }
-    T pop_front() { return data_[tail_++ % Size]; }
-    void push_back(const T& value) { data_[head_++ % Size] = value; }
-    T pop_back() { return data_[--head_ % Size]; }
+    T pop_front() { return data_[slot(tail_++)]; }
+    void push_back(const T& value) { data_[slot(head_++)] = value; }
+    T pop_back() { return data_[slot(--head_)]; }
 private:
     alignas(Align) std::array<T, Size> data_;
-    size_t head_{}, tail_{};
+    alignas(IndexAlign) size_t head_{};
+    alignas(IndexAlign) size_t tail_{};
 };
 
-
-
 }; // core::sort
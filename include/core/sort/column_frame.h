@@ -0,0 +1,319 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fmt/format.h>
+#include "frame.h"
+#include "key.h"
+#include "parallel.h"
+
+namespace core::sort {
+
+// A frame stored column-wise (structure-of-arrays). The columns are
+// laid out consecutively so that the column at byte offset `o` of the
+// equivalent row-major `Frame` is addressed by a `Key` with offset
+// `o`. The same `Keys` therefore apply to both layouts.
+//
+// Sorting permutes the key columns immediately. The payload columns
+// are either permuted immediately or, if the sort is lazy, the
+// permutation is recorded and applied to each column the first time
+// it is accessed through `column()`.
+class ColumnFrame {
+public:
+    struct Column {
+	size_t offset, width;
+	Frame::storage_type data;
+
+	const ElementType *value(size_t idx) const {
+	    return data.data() + idx * width;
+	}
+    };
+
+    ColumnFrame(size_t number_rows, const std::vector<size_t>& widths, bool initialize = true)
+	: nrows_(number_rows)
+	, stale_(widths.size(), false) {
+	size_t offset{};
+	for (auto width : widths) {
+	    columns_.push_back(Column{offset, width, Frame::storage_type(number_rows * width)});
+	    if (initialize) {
+		std::uniform_int_distribution<uint64_t> d{};
+		fill_random(columns_.back().data.data(), number_rows * width, d(core::rng()),
+			    default_concurrency());
+	    }
+	    offset += width;
+	}
+    }
+
+    // Return a column-wise copy of the row-major `frame` split into
+    // columns of the given `widths`.
+    static ColumnFrame from_frame(const Frame& frame, const std::vector<size_t>& widths,
+				  size_t nth = default_concurrency()) {
+	ColumnFrame cframe{frame.nrows(), widths, false};
+	if (cframe.bytes_per_row() != frame.bytes_per_row())
+	    throw std::runtime_error(fmt::format("column widths total {} bytes but frame has {}",
+						 cframe.bytes_per_row(), frame.bytes_per_row()));
+	parallel_for(nth, frame.nrows(), [&](size_t, size_t begin, size_t end) {
+	    for (auto& column : cframe.columns_)
+		for (auto i = begin; i < end; ++i)
+		    std::memcpy(column.data.data() + i * column.width,
+				frame.row(i) + column.offset, column.width);
+	});
+	return cframe;
+    }
+
+    // Return the equivalent row-major frame.
+    Frame to_frame(size_t nth = default_concurrency()) const {
+	Frame frame{nrows_, bytes_per_row(), false};
+	parallel_for(nth, nrows_, [&](size_t, size_t begin, size_t end) {
+	    for (size_t cdx = 0; cdx < columns_.size(); ++cdx) {
+		const auto& column = columns_[cdx];
+		for (auto i = begin; i < end; ++i)
+		    std::memcpy(frame.row(i) + column.offset, value(i, cdx), column.width);
+	    }
+	});
+	return frame;
+    }
+
+    auto nrows() const {
+	return nrows_;
+    }
+
+    auto ncolumns() const {
+	return columns_.size();
+    }
+
+    size_t bytes_per_row() const {
+	return columns_.empty() ? 0 : columns_.back().offset + columns_.back().width;
+    }
+
+    // Return the index of the column containing the field for `key`.
+    size_t find(const Key& key) const {
+	for (size_t cdx = 0; cdx < columns_.size(); ++cdx) {
+	    const auto& column = columns_[cdx];
+	    if (key.offset >= column.offset
+		and key.offset + key.length() <= column.offset + column.width)
+		return cdx;
+	}
+	throw std::runtime_error(fmt::format("no column contains key at offset {}", key.offset));
+    }
+
+    // Return the column `cdx`, first applying any pending permutation.
+    Column& column(size_t cdx) {
+	if (stale_[cdx]) {
+	    permute_column(columns_[cdx], pending_, default_concurrency());
+	    stale_[cdx] = false;
+	}
+	return columns_[cdx];
+    }
+
+    // Return a pointer to the value of column `cdx` for row `idx`
+    // reading through any pending permutation.
+    const ElementType *value(size_t idx, size_t cdx) const {
+	const auto& column = columns_[cdx];
+	return column.value(stale_[cdx] ? pending_[idx] : idx);
+    }
+
+    bool is_stale(size_t cdx) const {
+	return stale_[cdx];
+    }
+
+    // Reorder the rows so that new row `i` is the current row
+    // `index[i]`. The columns for which `eager` is true are permuted
+    // immediately and the remainder only when accessed.
+    void permute(const std::vector<RowIndex>& index, const std::vector<bool>& eager,
+		 size_t nth = default_concurrency()) {
+	bool any_stale = std::find(stale_.begin(), stale_.end(), true) != stale_.end();
+	bool any_lazy = std::find(eager.begin(), eager.end(), false) != eager.end();
+
+	// Only a single pending permutation is kept so the stale columns
+	// are brought up to date if a current column is about to become
+	// stale.
+	for (size_t cdx = 0; any_stale and cdx < columns_.size(); ++cdx) {
+	    if (not eager[cdx] and not stale_[cdx]) {
+		materialize(nth);
+		any_stale = false;
+	    }
+	}
+
+	// The stale columns are still in the order before the pending
+	// permutation so compose it with `index`.
+	std::vector<RowIndex> composed;
+	if (any_stale) {
+	    composed.resize(nrows_);
+	    for (size_t i = 0; i < nrows_; ++i)
+		composed[i] = pending_[index[i]];
+	}
+
+	for (size_t cdx = 0; cdx < columns_.size(); ++cdx) {
+	    if (eager[cdx]) {
+		permute_column(columns_[cdx], stale_[cdx] ? composed : index, nth);
+		stale_[cdx] = false;
+	    } else {
+		stale_[cdx] = true;
+	    }
+	}
+
+	if (not any_lazy) pending_.clear();
+	else if (any_stale) pending_ = std::move(composed);
+	else pending_ = index;
+    }
+
+    // Apply any pending permutation to all columns.
+    void materialize(size_t nth = default_concurrency()) {
+	for (size_t cdx = 0; cdx < columns_.size(); ++cdx) {
+	    if (stale_[cdx]) {
+		permute_column(columns_[cdx], pending_, nth);
+		stale_[cdx] = false;
+	    }
+	}
+	pending_.clear();
+    }
+
+private:
+    template<class T>
+    static void gather(T *dst, const T *src, const RowIndex *index, size_t begin, size_t end) {
+	for (auto i = begin; i < end; ++i)
+	    dst[i] = src[index[i]];
+    }
+
+    static void permute_column(Column& column, const std::vector<RowIndex>& index, size_t nth) {
+	Frame::storage_type data(column.data.size());
+	auto width = column.width;
+	const auto *src = column.data.data();
+	auto *dst = data.data();
+	parallel_for(nth, index.size(), [&](size_t, size_t begin, size_t end) {
+	    switch (width) {
+	    case 1:
+		gather(dst, src, index.data(), begin, end);
+		break;
+	    case 2:
+		gather((uint16_t*)dst, (const uint16_t*)src, index.data(), begin, end);
+		break;
+	    case 4:
+		gather((uint32_t*)dst, (const uint32_t*)src, index.data(), begin, end);
+		break;
+	    case 8:
+		gather((uint64_t*)dst, (const uint64_t*)src, index.data(), begin, end);
+		break;
+	    default:
+		for (auto i = begin; i < end; ++i)
+		    std::memcpy(dst + i * width, src + index[i] * width, width);
+		break;
+	    }
+	});
+	column.data = std::move(data);
+    }
+
+    size_t nrows_;
+    std::vector<Column> columns_;
+    std::vector<bool> stale_;
+    std::vector<RowIndex> pending_;
+};
+
+// Return the index that sorts `cframe` by `sort_keys`. This is a
+// stable LSD radix sort of a row-id column. The histograms are built
+// by sequential passes over the contiguous key columns and each
+// scatter pass reads only the narrow key column.
+auto column_sort_index(ColumnFrame& cframe, const Keys& sort_keys) {
+    using RadixIndex = RowIndex;
+    constexpr auto RadixSize = 257;
+    using SortIndex = std::vector<RadixIndex>;
+
+    check_radix_keys(sort_keys, "column_sort_index");
+    const auto nrows = cframe.nrows();
+
+    // A digit of the normalized key (see `RadixDigit`) read from a key
+    // column. The NULL flags of a nullable key are computed once.
+    struct Digit {
+	const ElementType *data;
+	size_t stride;
+	uint8_t mask;
+	const uint8_t *nulls;
+	bool null_digit;
+	uint8_t null_value;
+
+	uint8_t operator()(size_t idx) const {
+	    if (nulls) {
+		if (null_digit)
+		    return nulls[idx] ? null_value : 1;
+		if (nulls[idx])
+		    return 0;
+	    }
+	    return data[idx * stride] ^ mask;
+	}
+    };
+
+    std::vector<std::vector<uint8_t>> nulls(sort_keys.size());
+    std::vector<Digit> digits;
+    for (size_t kdx = 0; kdx < sort_keys.size(); ++kdx) {
+	const auto& key = sort_keys[kdx];
+	if (key.nullable()) {
+	    nulls[kdx].resize(nrows);
+	    if (key.null_source == NullSource::Bitmap) {
+		Key byte{DataType::Unsigned8, key.validity_bit / 8};
+		auto cdx = cframe.find(byte);
+		for (size_t i = 0; i < nrows; ++i)
+		    nulls[kdx][i] = not ((*cframe.value(i, cdx) >> (key.validity_bit % 8)) & 1);
+	    } else {
+		auto cdx = cframe.find(key);
+		auto skip = key.offset - cframe.column(cdx).offset;
+		for (size_t i = 0; i < nrows; ++i) {
+		    uint64_t value{};
+		    std::memcpy(&value, cframe.value(i, cdx) + skip,
+				std::min(key.length(), sizeof(value)));
+		    nulls[kdx][i] = value == key.sentinel;
+		}
+	    }
+	}
+
+	const auto& column = cframe.column(cframe.find(key));
+	auto base = column.data.data() - column.offset;
+	const uint8_t *key_nulls = key.nullable() ? nulls[kdx].data() : nullptr;
+	for (const auto& digit : radix_digits({key}))
+	    digits.push_back({base + digit.offset, column.width, digit.mask, key_nulls,
+			      digit.null_digit, uint8_t(key.nulls == NullOrder::First ? 0 : 2)});
+    }
+    std::reverse(digits.begin(), digits.end());
+    std::vector<RadixIndex> buckets(digits.size() * RadixSize);
+
+    for (size_t d = 0; d < digits.size(); ++d) {
+	auto *counts = &buckets[d * RadixSize];
+	const auto& digit = digits[d];
+	for (size_t j = 0; j < nrows; ++j)
+	    ++counts[1 + digit(j)];
+	for (auto j = 1; j < RadixSize; ++j)
+	    counts[j] += counts[j - 1];
+    }
+
+    SortIndex index(nrows), new_index(nrows);
+    for (size_t i = 0; i < nrows; ++i)
+	index[i] = i;
+
+    for (size_t d = 0; d < digits.size(); ++d) {
+	auto *counts = &buckets[d * RadixSize];
+	const auto& digit = digits[d];
+	for (size_t j = 0; j < nrows; ++j) {
+	    auto value = digit(index[j]);
+	    new_index[counts[value]++] = index[j];
+	}
+	std::swap(index, new_index);
+    }
+
+    return index;
+}
+
+// Sort `cframe` by `sort_keys`. The key columns are always permuted
+// immediately; the payload columns only if `lazy` is false.
+void column_sort(ColumnFrame& cframe, const Keys& sort_keys, bool lazy = false,
+		 size_t nth = default_concurrency()) {
+    auto index = column_sort_index(cframe, sort_keys);
+    std::vector<bool> eager(cframe.ncolumns(), not lazy);
+    for (const auto& key : sort_keys)
+	eager[cframe.find(key)] = true;
+    cframe.permute(index, eager, nth);
+}
+
+}; // core::sort
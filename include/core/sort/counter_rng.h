@@ -0,0 +1,63 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "parallel.h"
+
+namespace core::sort {
+
+// A counter-based pseudo random number generator. The value for
+// counter `i` is a pure function of the seed and `i` (the splitmix64
+// finalizer applied to a Weyl sequence) so that any subrange of a
+// stream can be generated independently and in parallel.
+class CounterRng {
+public:
+    static constexpr uint64_t Gamma = 0x9e3779b97f4a7c15ull;
+
+    explicit CounterRng(uint64_t seed)
+	: seed_(mix(seed)) {
+    }
+
+    uint64_t operator()(uint64_t counter) const {
+	return mix(seed_ + (counter + 1) * Gamma);
+    }
+
+    // Uniform double in [0, 1) for counter `i`.
+    double uniform(uint64_t counter) const {
+	return (operator()(counter) >> 11) * 0x1.0p-53;
+    }
+
+    static uint64_t mix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t seed_;
+};
+
+// Fill `nbytes` bytes at `data` with random bytes from the stream
+// `seed` using `nth` threads. The result does not depend on `nth`.
+void fill_random(uint8_t *data, size_t nbytes, uint64_t seed, size_t nth) {
+    constexpr size_t MinBytesPerThread = 1 << 20;
+    nth = std::min(nth, std::max<size_t>(1, nbytes / MinBytesPerThread));
+
+    CounterRng rng{seed};
+    size_t nwords = nbytes / sizeof(uint64_t);
+    parallel_for(nth, nwords, [&](size_t, size_t begin, size_t end) {
+	for (auto i = begin; i < end; ++i) {
+	    auto value = rng(i);
+	    std::memcpy(data + i * sizeof(uint64_t), &value, sizeof(uint64_t));
+	}
+    });
+
+    if (auto ntail = nbytes - nwords * sizeof(uint64_t); ntail > 0) {
+	auto value = rng(nwords);
+	std::memcpy(data + nwords * sizeof(uint64_t), &value, ntail);
+    }
+}
+
+}; // core::sort
@@ -0,0 +1,303 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fmt/format.h>
+#include "frame.h"
+#include "key.h"
+#include "packed_sort.h"
+#include "pipeline.h"
+#include "record_file.h"
+#include "replacement_selection.h"
+#include "sort.h"
+#include "sort_context.h"
+
+namespace core::sort {
+
+// Chunks       -- Sort chunks of rows that fit in memory, overlapping
+//                 reading, sorting and spilling.
+// Replacement  -- Replacement selection over a heap of rows, which
+//                 spills runs about twice as long as memory on random
+//                 input and one run for sorted input, at the cost of a
+//                 slower single-threaded row comparison per heap level.
+enum class RunGeneration { Chunks, Replacement };
+
+struct ExternalSortOptions {
+    // If true, rows with equal keys keep their input order.
+    bool stable{false};
+    size_t threads{1};
+    // Approximate bound on the memory used for rows and I/O buffers.
+    size_t memory_limit{size_t{1} << 30};
+    // Directory for the sorted runs, by default that of the output.
+    std::string spill_dir;
+    RecordIo io{RecordIo::Buffered};
+    // Number of chunk buffers cycling through reading, sorting and
+    // spilling runs. With three or more the stages overlap; one makes
+    // them sequential.
+    size_t io_buffers{3};
+    // Compression of the spilled runs. Packed runs take less disk
+    // bandwidth at the cost of encoding and decoding.
+    RecordCompression compression{RecordCompression::None};
+    RunGeneration runs{RunGeneration::Chunks};
+};
+
+struct ExternalSortStats {
+    size_t nrows{};
+    size_t nbytes{};
+    // Number of sorted runs spilled, zero if the input fit in memory.
+    size_t nruns{};
+    // Number of merge passes over the spilled runs.
+    size_t npasses{};
+    // Bytes of the spilled runs as first written.
+    size_t spill_bytes{};
+};
+
+namespace external_detail {
+
+// The smallest read buffer given to each run of a merge. It bounds the
+// merge fan-in for a given memory limit.
+inline constexpr size_t MinRunBuffer = size_t{1} << 20;
+
+// Removes the spilled run files that are still listed when destroyed.
+struct SpillFiles {
+    std::vector<std::string> paths;
+
+    ~SpillFiles() {
+	std::error_code ec;
+	for (const auto& path : paths)
+	    std::filesystem::remove(path, ec);
+    }
+};
+
+std::vector<size_t> string_offsets(const Schema& schema) {
+    std::vector<size_t> offsets;
+    for (const auto& column : schema.columns)
+	if (column.type == DataType::String)
+	    offsets.push_back(column.offset);
+    return offsets;
+}
+
+// Copy row `sidx` of `src` to row `didx` of `dst` moving the String
+// fields at `offsets` into the heap of `dst`.
+void copy_row(const Frame& src, size_t sidx, Frame& dst, size_t didx, const std::vector<size_t>& offsets) {
+    std::copy(src.row(sidx), src.row(sidx + 1), dst.row(didx));
+    for (auto offset : offsets) {
+	StringRef ref;
+	std::memcpy(&ref, src.row(sidx) + offset, sizeof(ref));
+	dst.set_string(didx, offset, {reinterpret_cast<const char*>(src.heap()) + ref.offset, ref.length});
+    }
+}
+
+// Sort `frame` in memory by `keys` with scratch from `context`. Without
+// String keys a single thread sorts a packed index, which is stable,
+// and moves each row once. Otherwise `sort` chooses the engine.
+void sort_chunk(Frame& frame, const Keys& keys, const ExternalSortOptions& options, SortContext& context) {
+    auto bound = bind_heap(frame, keys);
+    bool radix_keys = std::none_of(keys.begin(), keys.end(), [](const Key& key) {
+	return key.type == DataType::String;
+    });
+    if (radix_keys and options.threads <= 1)
+	order_by(frame, packed_index(frame, bound), context);
+    else
+	core::sort::sort(frame, bound, {.stable = options.stable, .threads = options.threads, .context = &context});
+}
+
+// One input of a merge: a run being read in chunks.
+struct MergeInput {
+    MergeInput(const std::string& path, const Keys& keys, const ExternalSortOptions& options,
+	       size_t buffer_bytes)
+	: reader(path, options.io, buffer_bytes)
+	, chunk(0, reader.schema().bytes_per_row, false)
+	, chunk_rows(std::max<size_t>(1, buffer_bytes / reader.schema().bytes_per_row)) {
+	next_chunk();
+	bound = bind_heap(chunk, keys);
+    }
+
+    bool empty() const {
+	return idx == chunk.nrows();
+    }
+
+    const uint8_t *row() const {
+	return chunk.row(idx);
+    }
+
+    void advance() {
+	if (++idx == chunk.nrows())
+	    next_chunk();
+    }
+
+    void next_chunk() {
+	reader.read(chunk, chunk_rows);
+	idx = 0;
+    }
+
+    RecordReader reader;
+    Frame chunk;
+    size_t chunk_rows, idx{};
+    Keys bound;
+};
+
+// Merge the sorted record files `inputs` into the record file `output`
+// with `compression` using about `memory` bytes for buffers. Equal
+// rows are taken from the earlier input first.
+void merge_files(const std::vector<std::string>& inputs, const std::string& output, const Schema& schema,
+		 const Keys& keys, const ExternalSortOptions& options, size_t memory,
+		 RecordCompression compression = RecordCompression::None) {
+    const auto buffer_bytes = std::max(MinRunBuffer, memory / (2 * (inputs.size() + 1)));
+    const auto offsets = string_offsets(schema);
+
+    std::vector<std::unique_ptr<MergeInput>> runs;
+    for (const auto& path : inputs)
+	runs.push_back(std::make_unique<MergeInput>(path, keys, options, buffer_bytes));
+
+    auto greater = [&](size_t a, size_t b) {
+	auto cmp = compare_rows(runs[a]->row(), runs[a]->bound, runs[b]->row(), runs[b]->bound);
+	return cmp > 0 or (cmp == 0 and a > b);
+    };
+    std::vector<size_t> heap;
+    for (size_t r = 0; r < runs.size(); ++r)
+	if (not runs[r]->empty())
+	    heap.push_back(r);
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    RecordWriter writer(output, schema, options.io, buffer_bytes, compression);
+    const auto batch_rows = std::max<size_t>(1, buffer_bytes / schema.bytes_per_row);
+    Frame batch(batch_rows, schema.bytes_per_row, false);
+    size_t nbatch{};
+    auto flush = [&]() {
+	batch.resize(nbatch);
+	writer.write(batch);
+	batch = Frame(batch_rows, schema.bytes_per_row, false);
+	nbatch = 0;
+    };
+
+    while (not heap.empty()) {
+	std::pop_heap(heap.begin(), heap.end(), greater);
+	auto& run = *runs[heap.back()];
+	if (offsets.empty()) std::copy(run.row(), run.row() + schema.bytes_per_row, batch.row(nbatch));
+	else copy_row(run.chunk, run.idx, batch, nbatch, offsets);
+	if (++nbatch == batch_rows)
+	    flush();
+
+	run.advance();
+	if (run.empty()) heap.pop_back();
+	else std::push_heap(heap.begin(), heap.end(), greater);
+    }
+    if (nbatch > 0)
+	flush();
+    writer.close();
+}
+
+}; // external_detail
+
+// Sort the record file `input` by `keys` into the record file
+// `output`, which may be the same file. If the input does not fit in
+// `options.memory_limit` it is spilled as sorted runs, generated as
+// `options.runs` chooses, to `options.spill_dir` and then merged, in
+// several passes if there are more runs than the memory allows to
+// merge at once. Runs are packed if `options.compression` asks for it.
+// The output is written to a temporary file that replaces `output`
+// when complete.
+ExternalSortStats external_sort(const std::string& input, const std::string& output, const Keys& keys,
+				const ExternalSortOptions& options = {}) {
+    namespace fs = std::filesystem;
+    using namespace external_detail;
+
+    ExternalSortStats stats;
+    RecordReader reader(input, options.io);
+    const auto schema = reader.schema();
+    const auto bpr = schema.bytes_per_row;
+    stats.nrows = reader.header().nrows;
+    stats.nbytes = stats.nrows * bpr;
+
+    auto spill_dir = options.spill_dir.empty()
+	? fs::absolute(output).parent_path()
+	: fs::path(options.spill_dir);
+    auto stem = fmt::format("{}.{}", fs::path(output).filename().string(), ::getpid());
+    SpillFiles files;
+    auto spill_path = [&](std::string_view kind) {
+	files.paths.push_back((spill_dir / fmt::format("{}.{}{}", stem, kind, files.paths.size())).string());
+	return files.paths.back();
+    };
+    auto final_path = (fs::absolute(output).parent_path() / fmt::format(".{}.tmp", stem)).string();
+    files.paths.push_back(final_path);
+
+    // Rows and the sort scratch of a chunk both count against the
+    // limit, as does each chunk buffer when spilling.
+    if (stats.nrows <= std::max<size_t>(1, options.memory_limit / (2 * bpr))) {
+	Frame chunk(0, bpr, false);
+	SortContext context;
+	reader.read(chunk, stats.nrows);
+	sort_chunk(chunk, keys, options, context);
+	write_record_file(final_path, chunk, schema, options.io);
+    } else {
+	std::vector<std::string> runs;
+	if (options.runs == RunGeneration::Replacement) {
+	    // The heap of rows takes half the limit like an in-memory sort.
+	    const auto capacity = std::max<size_t>(1, options.memory_limit / (2 * bpr));
+	    const auto batch_rows = std::max<size_t>(1, MinRunBuffer / bpr);
+	    std::unique_ptr<RecordWriter> writer;
+	    auto close_run = [&]() {
+		if (writer) {
+		    writer->close();
+		    stats.spill_bytes += fs::file_size(runs.back());
+		}
+	    };
+	    replacement_selection(capacity, bpr, keys,
+				  [&](Frame& chunk, size_t max_rows) { return reader.read(chunk, max_rows); },
+				  [&](size_t run, const Frame& batch) {
+				      if (run == runs.size()) {
+					  close_run();
+					  runs.push_back(spill_path("run"));
+					  writer = std::make_unique<RecordWriter>(runs.back(), schema, options.io,
+										  MinRunBuffer, options.compression);
+				      }
+				      writer->write(batch);
+				  }, batch_rows);
+	    close_run();
+	} else {
+	    const auto nbuffers = std::max<size_t>(1, options.io_buffers);
+	    const auto chunk_rows = std::max<size_t>(1, options.memory_limit / ((nbuffers + 1) * bpr));
+	    // The chunks are sorted one at a time through a single scratch
+	    // frame, which trades places with each buffer it sorts.
+	    SortContext context;
+	    pipeline_chunks(reader, chunk_rows,
+			    [&](Frame& chunk) { sort_chunk(chunk, keys, options, context); },
+			    [&](const Frame& chunk) {
+				runs.push_back(spill_path("run"));
+				write_record_file(runs.back(), chunk, schema, options.io, options.compression);
+				stats.spill_bytes += fs::file_size(runs.back());
+			    }, nbuffers);
+	}
+	stats.nruns = runs.size();
+
+	const auto fan_in = std::max<size_t>(2, options.memory_limit / (2 * MinRunBuffer));
+	while (runs.size() > fan_in) {
+	    std::vector<std::string> merged;
+	    for (size_t begin = 0; begin < runs.size(); begin += fan_in) {
+		std::vector<std::string> group(runs.begin() + begin,
+					       runs.begin() + std::min(begin + fan_in, runs.size()));
+		merged.push_back(spill_path("merge"));
+		merge_files(group, merged.back(), schema, keys, options, options.memory_limit,
+			    options.compression);
+		for (const auto& path : group)
+		    fs::remove(path);
+	    }
+	    runs = std::move(merged);
+	    ++stats.npasses;
+	}
+	merge_files(runs, final_path, schema, keys, options, options.memory_limit);
+	++stats.npasses;
+    }
+
+    fs::rename(final_path, output);
+    return stats;
+}
+
+}; // core::sort
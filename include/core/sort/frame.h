@@ -5,23 +5,39 @@
 #include <span>
 #include <fmt/format.h>
 #include "core/util/random.h"
+#include "allocator.h"
+#include "counter_rng.h"
+#include "parallel.h"
+#include "key.h"
 #include "type.h"
 
 namespace core::sort {
 
 using ElementType = uint8_t;
 
+// The default element type of a sort index. Frames of 4G or more rows
+// need a 64-bit index such as `radix_index<uint64_t>`.
+using RowIndex = uint32_t;
+
 class Frame {
 public:
     using element_type = ElementType;
+    using storage_type = std::vector<ElementType, PageAllocator<ElementType>>;
     
-    Frame(size_t number_rows, size_t bytes_per_row, bool initialize = true)
-	: storage_(number_rows * bytes_per_row)
+    // Construct a frame with `number_rows` rows of `bytes_per_row`
+    // bytes whose storage is allocated according to `policy`. If
+    // `initialize` is true, the rows are filled with random bytes in
+    // parallel, otherwise the storage is left uninitialized and
+    // untouched.
+    Frame(size_t number_rows, size_t bytes_per_row, bool initialize = true,
+	  PagePolicy policy = PagePolicy::Default)
+	: storage_(number_rows * bytes_per_row, PageAllocator<ElementType>(policy))
 	, nrows_(number_rows)
 	, bytes_per_row_(bytes_per_row) {
-	std::uniform_int_distribution<uint8_t> d{};
-	for (auto i = 0; i < nrows_ * bytes_per_row_; ++i)
-	    storage_[i] = d(core::rng());
+	if (initialize) {
+	    std::uniform_int_distribution<uint64_t> d{};
+	    fill_random(storage_.data(), storage_.size(), d(core::rng()), default_concurrency());
+	}
     }
 
     Frame clone() const {
@@ -29,12 +45,15 @@ public:
     }
 
     Frame empty_clone() const {
-	return Frame(nrows_, bytes_per_row_, false);
+	Frame frame(nrows_, bytes_per_row_, false, policy());
+	frame.heap_ = heap_;
+	return frame;
     }
 
-    Frame order_by(const std::vector<int>& index) const {
-	Frame copy = clone();
-	for (auto i = 0; i < index.size(); ++i)
+    template<class Index, class Alloc>
+    Frame order_by(const std::vector<Index, Alloc>& index) const {
+	Frame copy = empty_clone();
+	for (size_t i = 0; i < index.size(); ++i)
 	    std::copy(row(index[i]), row(index[i] + 1), copy.row(i));
 	return copy;
     }
@@ -47,6 +66,10 @@ public:
 	return bytes_per_row_;
     }
 
+    PagePolicy policy() const {
+	return storage_.get_allocator().policy();
+    }
+
     auto data() {
 	return storage_.data();
     }
@@ -83,6 +106,71 @@ public:
 	std::swap_ranges(row(idx), row(idx+1), row(jdx));
     }
 
+    // Touch every page of the rows on `nth` threads, each taking the
+    // chunk of rows that `parallel_for(nth, nrows(), work, align)` would
+    // give it, so the pages of an untouched frame are placed on the NUMA
+    // node of the thread that will sort them. The contents are kept.
+    void first_touch(size_t nth, size_t align = 1) {
+	constexpr size_t PageSize = 4096;
+	parallel_for(nth, nrows_, [&](size_t, size_t begin, size_t end) {
+	    auto *first = row(begin), *last = row(end);
+	    auto *page = reinterpret_cast<volatile element_type*>(
+		reinterpret_cast<uintptr_t>(first) / PageSize * PageSize);
+	    if (page < first)
+		page += PageSize;
+	    for (; page < last; page += PageSize)
+		*page = *page;
+	}, align);
+    }
+
+    // Resize the frame to `number_rows` rows. New rows are left
+    // uninitialized.
+    void resize(size_t number_rows) {
+	storage_.resize(number_rows * bytes_per_row_);
+	nrows_ = number_rows;
+    }
+
+    // Append the rows of `other` which must have the same number of
+    // bytes per row. String fields of `other` are copied as is so both
+    // frames must share the same side heap.
+    void append(const Frame& other) {
+	if (other.bytes_per_row() != bytes_per_row_)
+	    throw std::runtime_error(fmt::format("Frame::append: expected {} bytes per row, got {}",
+						 bytes_per_row_, other.bytes_per_row()));
+	storage_.insert(storage_.end(), other.begin(), other.end());
+	nrows_ += other.nrows();
+    }
+
+    // Append `str` to the side heap for String fields and return a
+    // reference to it. The heap is append-only and shared by clones of
+    // this frame so existing references remain valid, but appending
+    // may reallocate it, which leaves the `Key::heap` of keys from
+    // `bind_heap` dangling. Call `bind_heap` again after adding
+    // strings. Throws if the reference does not fit in a `StringRef`.
+    StringRef add_string(std::string_view str) {
+	if (not heap_)
+	    heap_ = std::make_shared<storage_type>();
+	auto ref = make_string_ref(heap_->size(), str.size());
+	heap_->insert(heap_->end(), str.begin(), str.end());
+	return ref;
+    }
+
+    // Set the String field at `offset` in row `idx` to `str`.
+    void set_string(size_t idx, size_t offset, std::string_view str) {
+	auto ref = add_string(str);
+	std::memcpy(row(idx) + offset, &ref, sizeof(ref));
+    }
+
+    const element_type *heap() const {
+	return heap_ ? heap_->data() : nullptr;
+    }
+
+    // Share the side heap of `other` so String fields copied from it
+    // remain valid.
+    void share_heap(const Frame& other) {
+	heap_ = other.heap_;
+    }
+
     auto operator[](size_t idx) const {
 	return storage_[idx];
     }
@@ -92,10 +180,20 @@ public:
     }
 
 private:
-    std::vector<ElementType> storage_;
+    storage_type storage_;
     size_t nrows_, bytes_per_row_;
+    std::shared_ptr<storage_type> heap_;
 };
 
+// Return `keys` with any String keys bound to the side heap of
+// `frame`. The binding is invalidated by adding strings to the heap.
+Keys bind_heap(const Frame& frame, Keys keys) {
+    for (auto& key : keys)
+	if (key.type == DataType::String)
+	    key.heap = frame.heap();
+    return keys;
+}
+
 std::ostream& operator<<(std::ostream& os, const Frame& frame) {
     for (auto i = 0; i < frame.nrows(); ++i) {
 	for (auto j = 0; j < frame.bytes_per_row(); ++j)
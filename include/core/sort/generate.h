@@ -0,0 +1,179 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <cmath>
+#include <stdexcept>
+#include "counter_rng.h"
+#include "frame.h"
+#include "key.h"
+
+namespace core::sort {
+
+// The distribution of the values generated for a key column.
+//
+// Uniform    -- Uniformly random values over the full range of the type.
+// Zipf       -- Ranks in [0, cardinality) with frequency proportional
+//               to 1 / (rank + 1)^skew.
+// Duplicates -- Uniformly random draws from `cardinality` distinct values.
+// Runs       -- Consecutive ascending runs of `run_length` rows.
+enum class Distribution { Uniform, Zipf, Duplicates, Runs };
+
+struct ColumnGenerator {
+    Key key;
+    Distribution distribution{Distribution::Uniform};
+    uint64_t cardinality{1024};
+    double skew{1.0};
+    uint64_t run_length{1024};
+};
+
+using ColumnGenerators = std::vector<ColumnGenerator>;
+
+}; // core::sort
+
+namespace core::str::detail {
+using Distribution = core::sort::Distribution;
+template<>
+struct lexical_cast_impl<Distribution> {
+    static Distribution parse(std::string_view s) {
+	using enum core::sort::Distribution;
+	if (s == "uniform") return Uniform;
+	else if (s == "zipf") return Zipf;
+	else if (s == "duplicates") return Duplicates;
+	else if (s == "runs") return Runs;
+	throw lexical_cast_error(s, "Distribution");
+    }
+};
+}; // core::str::detail
+
+namespace core::sort {
+
+std::ostream& operator<<(std::ostream& os, Distribution distribution) {
+    switch (distribution) {
+	using enum Distribution;
+    case Uniform:
+	os << "uniform";
+	break;
+    case Zipf:
+	os << "zipf";
+	break;
+    case Duplicates:
+	os << "duplicates";
+	break;
+    case Runs:
+	os << "runs";
+	break;
+    }
+    return os;
+}
+
+namespace detail {
+
+// Store the low `key.length()` bytes of `value` (extended by `high`
+// for 128-bit fields), interpreted as an unsigned (order preserving)
+// value, into the field for `key`. A
+// FixedString field receives the big-endian bytes of `value` followed
+// by zero padding.
+void store_value(uint8_t *row, const Key& key, uint64_t value, uint64_t high = 0) {
+    if (key.type == DataType::FixedString) {
+	auto *field = row + key.offset;
+	auto n = std::min<size_t>(key.width, sizeof(value));
+	for (size_t i = 0; i < n; ++i)
+	    field[i] = value >> (8 * (sizeof(value) - 1 - i));
+	std::fill(field + n, field + key.width, 0);
+	return;
+    }
+    if (key.type == DataType::String)
+	throw std::runtime_error("generate: String columns are not supported");
+
+    auto nbits = 8 * key.length();
+    unsigned __int128 wide = value;
+    if (nbits > 64)
+	wide |= static_cast<unsigned __int128>(high) << 64;
+    if (is_signed(key.type))
+	wide ^= static_cast<unsigned __int128>(1) << (nbits - 1);
+    std::memcpy(row + key.offset, &wide, key.length());
+}
+
+uint64_t max_value(const Key& key) {
+    auto nbits = 8 * std::min<size_t>(key.length(), sizeof(uint64_t));
+    return nbits >= 64 ? ~uint64_t{0} : (uint64_t{1} << nbits) - 1;
+}
+
+uint64_t zipf_rank(double u, uint64_t n, double s) {
+    double x;
+    if (std::abs(s - 1.0) < 1e-9) x = std::pow(double(n), u);
+    else x = std::pow((std::pow(double(n), 1.0 - s) - 1.0) * u + 1.0, 1.0 / (1.0 - s));
+    return std::min<uint64_t>(n, std::max<uint64_t>(1, uint64_t(x))) - 1;
+}
+
+}; // detail
+
+// Overwrite the columns of `frame` described by `columns` with values
+// drawn from their distributions using `nth` threads. The value
+// generated for a given row depends only on `seed`, the column and the
+// row so the result is independent of `nth`. Throws if a Zipf or
+// Duplicates column has a zero cardinality.
+void generate(Frame& frame, const ColumnGenerators& columns, uint64_t seed,
+	      size_t nth = default_concurrency()) {
+    for (const auto& column : columns)
+	if (column.cardinality == 0 and (column.distribution == Distribution::Zipf
+					 or column.distribution == Distribution::Duplicates))
+	    throw std::runtime_error("generate: Zipf and Duplicates columns require a cardinality");
+
+    constexpr size_t MinRowsPerThread = 1 << 14;
+    nth = std::min(nth, std::max<size_t>(1, frame.nrows() / MinRowsPerThread));
+
+    parallel_for(nth, frame.nrows(), [&](size_t, size_t begin, size_t end) {
+	for (size_t cdx = 0; cdx < columns.size(); ++cdx) {
+	    const auto& column = columns[cdx];
+	    const auto& key = column.key;
+	    CounterRng rng{seed + cdx * CounterRng::Gamma};
+	    CounterRng scramble{~seed + cdx * CounterRng::Gamma};
+
+	    switch (column.distribution) {
+		using enum Distribution;
+	    case Uniform:
+		for (auto i = begin; i < end; ++i)
+		    detail::store_value(frame.row(i), key, rng(i), scramble(i));
+		break;
+	    case Zipf:
+		for (auto i = begin; i < end; ++i) {
+		    auto rank = detail::zipf_rank(rng.uniform(i), column.cardinality, column.skew);
+		    detail::store_value(frame.row(i), key, rank);
+		}
+		break;
+	    case Duplicates:
+		for (auto i = begin; i < end; ++i)
+		    detail::store_value(frame.row(i), key, scramble(rng(i) % column.cardinality));
+		break;
+	    case Runs:
+		{
+		    auto run_length = std::max<uint64_t>(1, column.run_length);
+		    auto step = detail::max_value(key) / run_length;
+		    for (auto i = begin; i < end; ++i) {
+			auto position = i % run_length;
+			auto value = step > 0 ? position * step + rng(i) % step : position;
+			detail::store_value(frame.row(i), key, value);
+		    }
+		}
+		break;
+	    }
+	}
+    });
+}
+
+// Return a new frame of `number_rows` by `bytes_per_row` filled with
+// random bytes and with `columns` generated from their distributions.
+// The rows are written in parallel so their pages are first touched
+// by the `nth` threads.
+Frame generate_frame(size_t number_rows, size_t bytes_per_row, const ColumnGenerators& columns,
+		     uint64_t seed, size_t nth = default_concurrency(),
+		     PagePolicy policy = PagePolicy::Default) {
+    Frame frame{number_rows, bytes_per_row, false, policy};
+    fill_random(frame.data(), number_rows * bytes_per_row, seed, nth);
+    generate(frame, columns, seed, nth);
+    return frame;
+}
+
+}; // core::sort
@@ -0,0 +1,123 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "frame.h"
+#include "key.h"
+#include "insertion_sort.h"
+
+namespace core::sort {
+
+// Offsets of the first row of each group of equal keys in a sorted
+// frame followed by the number of rows, so group `i` is the rows
+// [offsets[i], offsets[i + 1]) and has offsets[i + 1] - offsets[i] rows.
+using GroupOffsets = std::vector<size_t>;
+
+namespace group_detail {
+
+struct Run {
+    size_t begin, end;
+};
+
+// Bottom-up merge sort over runs that can shrink. If `Unique`, equal
+// rows are dropped as soon as they meet, first within each sorted
+// block and then in every merge, keeping the earliest row. If
+// `offsets` is non-null, the group offsets are recorded as rows are
+// emitted by the final merge. Returns the number of rows remaining.
+template<bool Unique>
+size_t merge_sort_runs(Frame& frame, const Keys& keys, GroupOffsets *offsets) {
+    constexpr size_t BlockSize = 16;
+    const auto n = frame.nrows();
+    const auto bpr = frame.bytes_per_row();
+
+    std::vector<Run> runs;
+    for (size_t bdx = 0, wdx = 0; bdx < n; bdx += BlockSize) {
+	auto edx = std::min(bdx + BlockSize, n);
+	insertion_sort(frame, keys, bdx, edx);
+	auto begin = wdx;
+	for (auto idx = bdx; idx < edx; ++idx) {
+	    if (Unique and wdx > begin and not compare(frame.row(wdx - 1), frame.row(idx), keys))
+		continue;
+	    if (wdx != idx)
+		std::copy(frame.row(idx), frame.row(idx + 1), frame.row(wdx));
+	    ++wdx;
+	}
+	runs.push_back({begin, wdx});
+    }
+
+    Frame buffer = frame.empty_clone();
+    Frame *src = &frame, *dst = &buffer;
+    while (runs.size() > 1) {
+	const bool last = runs.size() == 2;
+	std::vector<Run> merged;
+	size_t out{};
+	const uint8_t *prev{};
+	auto emit = [&](const uint8_t *ptr) {
+	    if (last and offsets and (not prev or compare(prev, ptr, keys)))
+		offsets->push_back(out);
+	    prev = std::copy(ptr, ptr + bpr, dst->row(out)) - bpr;
+	    ++out;
+	};
+
+	for (size_t rdx = 0; rdx < runs.size(); rdx += 2) {
+	    auto begin = out;
+	    auto [ldx, ledx] = runs[rdx];
+	    auto [mdx, medx] = rdx + 1 < runs.size() ? runs[rdx + 1] : Run{0, 0};
+	    while (ldx < ledx and mdx < medx) {
+		auto lptr = src->row(ldx), rptr = src->row(mdx);
+		if (compare(rptr, lptr, keys)) {
+		    emit(rptr);
+		    ++mdx;
+		} else {
+		    if (Unique and not compare(lptr, rptr, keys))
+			++mdx;
+		    emit(lptr);
+		    ++ldx;
+		}
+	    }
+	    for (; ldx < ledx; ++ldx)
+		emit(src->row(ldx));
+	    for (; mdx < medx; ++mdx)
+		emit(src->row(mdx));
+	    merged.push_back({begin, out});
+	}
+	runs = std::move(merged);
+	std::swap(src, dst);
+    }
+
+    if (src != &frame)
+	std::swap(frame, buffer);
+
+    auto count = runs.empty() ? 0 : runs.front().end;
+    if (offsets and offsets->empty())
+	for (size_t idx = 0; idx < count; ++idx)
+	    if (idx == 0 or compare(frame.row(idx - 1), frame.row(idx), keys))
+		offsets->push_back(idx);
+    if (offsets)
+	offsets->push_back(count);
+    return count;
+}
+
+}; // group_detail
+
+// Sort `frame` by `keys` and remove rows with duplicate keys, keeping
+// the first occurrence of each key. Duplicates are dropped during the
+// merge passes so later passes move fewer rows. The frame is resized
+// to the number of unique keys.
+void sort_unique(Frame& frame, const Keys& keys) {
+    auto count = group_detail::merge_sort_runs<true>(frame, bind_heap(frame, keys), nullptr);
+    frame.resize(count);
+}
+
+// Stable sort of `frame` by `keys` that returns the offsets of the
+// groups of equal keys. The offsets are recorded by the final merge
+// pass rather than a separate pass over the sorted frame.
+GroupOffsets sort_groups(Frame& frame, const Keys& keys) {
+    GroupOffsets offsets;
+    group_detail::merge_sort_runs<false>(frame, bind_heap(frame, keys), &offsets);
+    return offsets;
+}
+
+}; // core::sort
@@ -0,0 +1,243 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <vector>
+#include "frame.h"
+#include "key.h"
+#include "scatter.h"
+
+namespace core::sort {
+
+// Merge  -- Stable bottom-up merge sort of the rows, one pass per
+//           doubling of the run width.
+// Radix  -- Stable LSD radix sort of an index, one pass per key byte,
+//           followed by a pass moving each row once. String keys are
+//           not supported.
+enum class IncrementalEngine { Merge, Radix };
+
+// Running    -- More steps are needed.
+// Done       -- The frame is sorted.
+// Cancelled  -- The sort was cancelled before it completed.
+enum class SortStatus { Running, Done, Cancelled };
+
+struct SortProgress {
+    // Units of work done and in total, one unit per row per pass.
+    size_t done{}, total{};
+
+    double fraction() const {
+	return total ? double(done) / total : 1.0;
+    }
+};
+
+// A sort of `frame` by `keys` that runs in bounded steps so it can be
+// interleaved with other work on the calling thread, resumed later and
+// cancelled. Each call to `step` does up to the given number of units
+// of work, one unit being one row moved or counted by one pass, and
+// `run_for` steps until a time slice is used. `cancel` may be called
+// from any thread and takes effect at the next step. A cancelled Merge
+// sort leaves the rows of `frame` in an unspecified order, while a
+// cancelled Radix sort leaves `frame` unchanged since it is only
+// reordered by the last pass. `frame` must not be used by others until
+// the sort is done or cancelled.
+class IncrementalSort {
+public:
+    IncrementalSort(Frame& frame, const Keys& keys, IncrementalEngine engine = IncrementalEngine::Merge)
+	: frame_(frame)
+	, keys_(bind_heap(frame, keys))
+	, engine_(engine)
+	, nrows_(frame.nrows()) {
+	if (engine_ == IncrementalEngine::Radix) {
+	    check_radix_keys(keys_, "IncrementalSort");
+	    digits_ = radix_digits(keys_);
+	    std::reverse(digits_.begin(), digits_.end());
+	    npasses_ = nrows_ < 2 ? 0 : digits_.size() + 2;
+	    buckets_.assign(digits_.size() * RadixSize, 0);
+	} else {
+	    for (size_t w = 1; w < nrows_; w *= 2)
+		++npasses_;
+	}
+	if (npasses_ == 0)
+	    status_ = SortStatus::Done;
+    }
+
+    IncrementalSort(const IncrementalSort&) = delete;
+    IncrementalSort& operator=(const IncrementalSort&) = delete;
+
+    // Do up to `budget` units of work. Returns the status afterwards.
+    SortStatus step(size_t budget) {
+	if (status_ == SortStatus::Running and cancelled_.load(std::memory_order_relaxed)) {
+	    status_ = SortStatus::Cancelled;
+	    release();
+	}
+	if (status_ != SortStatus::Running)
+	    return status_;
+
+	budget = std::max<size_t>(1, budget);
+	if (engine_ == IncrementalEngine::Merge) merge_step(budget);
+	else radix_step(budget);
+	if (pass_ == npasses_) {
+	    status_ = SortStatus::Done;
+	    release();
+	}
+	return status_;
+    }
+
+    // Step in quanta of `quantum` units until `slice` has elapsed or
+    // the sort is done or cancelled. Returns the status afterwards.
+    template<class Rep, class Period>
+    SortStatus run_for(std::chrono::duration<Rep, Period> slice, size_t quantum = DefaultQuantum) {
+	auto deadline = std::chrono::steady_clock::now() + slice;
+	while (step(quantum) == SortStatus::Running)
+	    if (std::chrono::steady_clock::now() >= deadline)
+		break;
+	return status_;
+    }
+
+    // Run to completion or cancellation.
+    SortStatus run() {
+	while (step(DefaultQuantum) == SortStatus::Running);
+	return status_;
+    }
+
+    // Request cancellation. The scratch memory is released by the next
+    // step.
+    void cancel() {
+	cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    SortStatus status() const {
+	return status_;
+    }
+
+    SortProgress progress() const {
+	return {pass_ * nrows_ + pos_, npasses_ * nrows_};
+    }
+
+    // The default units of work between checks of the clock.
+    static constexpr size_t DefaultQuantum = 1 << 14;
+
+private:
+    static constexpr size_t RadixSize = 257;
+
+    void release() {
+	buffer_ = Frame(0, 1, false);
+	index_ = {};
+	new_index_ = {};
+	combiner_.reset();
+    }
+
+    void copy_row(const uint8_t *src, Frame& dst, size_t idx) {
+	std::copy(src, src + frame_.bytes_per_row(), dst.row(idx));
+    }
+
+    // Continue merging pairs of runs of width `width_` from `frame_`
+    // into `buffer_`. The merge of a pair resumes at `left_` and
+    // `right_` with the output at `pos_`.
+    void merge_step(size_t budget) {
+	if (pass_ == 0 and pos_ == 0)
+	    buffer_ = frame_.empty_clone();
+	while (budget > 0 and pass_ < npasses_) {
+	    auto lend = std::min(pair_ + width_, nrows_), rend = std::min(pair_ + 2 * width_, nrows_);
+	    if (pos_ == pair_) {
+		left_ = pair_;
+		right_ = lend;
+	    }
+	    for (; budget > 0 and pos_ < rend; --budget, ++pos_) {
+		if (left_ < lend and (right_ == rend or not compare(frame_.row(right_), frame_.row(left_), keys_)))
+		    copy_row(frame_.row(left_++), buffer_, pos_);
+		else
+		    copy_row(frame_.row(right_++), buffer_, pos_);
+	    }
+	    if (pos_ == rend) {
+		pair_ = rend;
+		if (pair_ == nrows_) {
+		    std::swap(frame_, buffer_);
+		    width_ *= 2;
+		    pos_ = pair_ = 0;
+		    ++pass_;
+		}
+	    }
+	}
+    }
+
+    // Continue the current radix pass: counting every digit, scattering
+    // by one digit or moving the rows to their sorted positions.
+    void radix_step(size_t budget) {
+	const auto ndigits = digits_.size();
+	if (pass_ == 0 and pos_ == 0) {
+	    index_.resize(nrows_);
+	    new_index_.resize(nrows_);
+	}
+	while (budget > 0 and pass_ < npasses_) {
+	    auto end = std::min(nrows_, pos_ + budget);
+	    budget -= end - pos_;
+	    if (pass_ == 0) {
+		for (; pos_ < end; ++pos_) {
+		    auto row = frame_.row(pos_);
+		    for (size_t bdx = 0; bdx < ndigits; ++bdx)
+			++buckets_[bdx * RadixSize + 1 + digits_[bdx](row)];
+		    index_[pos_] = pos_;
+		}
+		if (pos_ == nrows_) {
+		    for (size_t bdx = 0; bdx < ndigits; ++bdx) {
+			auto *counts = &buckets_[bdx * RadixSize];
+			for (size_t j = 1; j < RadixSize; ++j)
+			    counts[j] += counts[j - 1];
+		    }
+		    combiner_.emplace(new_index_.data(), buckets_.data(), RadixSize - 1);
+		}
+	    } else if (pass_ <= ndigits) {
+		const auto& digit = digits_[pass_ - 1];
+		for (; pos_ < end; ++pos_) {
+		    if (pos_ + RadixPrefetchDistance < nrows_)
+			__builtin_prefetch(frame_.row(index_[pos_ + RadixPrefetchDistance]) + digit.offset);
+		    combiner_->push(digit(frame_.row(index_[pos_])), index_[pos_]);
+		}
+		if (pos_ == nrows_) {
+		    combiner_->flush();
+		    std::swap(index_, new_index_);
+		    if (pass_ < ndigits)
+			combiner_->reset(new_index_.data(), &buckets_[pass_ * RadixSize]);
+		    else
+			buffer_ = frame_.empty_clone();
+		}
+	    } else {
+		for (; pos_ < end; ++pos_) {
+		    if (pos_ + RadixPrefetchDistance < nrows_)
+			__builtin_prefetch(frame_.row(index_[pos_ + RadixPrefetchDistance]));
+		    copy_row(frame_.row(index_[pos_]), buffer_, pos_);
+		}
+		if (pos_ == nrows_)
+		    std::swap(frame_, buffer_);
+	    }
+	    if (pos_ == nrows_) {
+		pos_ = 0;
+		++pass_;
+	    }
+	}
+    }
+
+    Frame& frame_;
+    Keys keys_;
+    IncrementalEngine engine_;
+    size_t nrows_, npasses_{}, pass_{}, pos_{};
+    SortStatus status_{SortStatus::Running};
+    std::atomic<bool> cancelled_{false};
+    Frame buffer_{0, 1, false};
+
+    // Merge state.
+    size_t width_{1}, pair_{}, left_{}, right_{};
+
+    // Radix state.
+    RadixDigits digits_;
+    std::vector<RowIndex> index_, new_index_;
+    std::vector<size_t> buckets_;
+    std::optional<WriteCombiner<RowIndex>> combiner_;
+};
+
+}; // core::sort
@@ -3,6 +3,8 @@
 
 #pragma once
 #include <utility>
+#include "frame.h"
+#include "key.h"
 
 namespace core::sort {
 
@@ -27,4 +29,11 @@ void insertion_sort(Iter begin, Iter end, Compare compare) {
     }
 }
 
+// Stable insertion sort of the rows [begin, end) of `frame`.
+void insertion_sort(Frame& frame, const Keys& keys, size_t begin, size_t end) {
+    for (auto i = begin + 1; i < end; ++i)
+	for (auto j = i; j > begin and compare(frame.row(j), frame.row(j - 1), keys); --j)
+	    frame.swap_rows(j, j - 1);
+}
+
 }; // core::sort
@@ -23,18 +23,20 @@ bool is_sorted(const T *data, size_t n, size_t l, Compare compare) {
 }
 
 bool is_sorted(const Frame& frame, const Keys& sort_keys) {
+    auto keys = bind_heap(frame, sort_keys);
     return is_sorted(frame.row(0), frame.nrows(), frame.bytes_per_row(),
 		     [&](const auto *a, const auto *b) {
-			 return compare(a, b, sort_keys);
+			 return compare(a, b, keys);
 		     });
 }
 
-bool is_sorted(const std::vector<int>& index, const Frame& frame, const Keys& sort_keys) {
+template<class Index, class Alloc>
+bool is_sorted(const std::vector<Index, Alloc>& index, const Frame& frame, const Keys& sort_keys) {
     return is_sorted(frame.order_by(index), sort_keys);
 }
 
 bool is_sorted(const std::vector<const ElementType*>& ptrs, const Keys& sort_keys) {
-    for (auto i = 1; i < ptrs.size(); ++i)
+    for (size_t i = 1; i < ptrs.size(); ++i)
 	if (compare(ptrs[i], ptrs[i-1], sort_keys))
 	    return false;
     return true;
@@ -0,0 +1,194 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <vector>
+#include "frame.h"
+#include "key.h"
+#include "parallel.h"
+#include "radix_sort_index.h"
+#include "std_sort_index.h"
+#include "string_sort.h"
+
+namespace core::sort {
+
+// Inner -- Pairs of matching left and right rows.
+// Left  -- Inner pairs plus each unmatched left row paired with NoRow.
+// Semi  -- Each left row with at least one match, paired with its
+//          first matching right row.
+enum class JoinType { Inner, Left, Semi };
+
+struct JoinPair {
+    static constexpr RowIndex NoRow = std::numeric_limits<RowIndex>::max();
+    RowIndex left, right;
+
+    bool operator==(const JoinPair&) const = default;
+};
+
+using JoinPairs = std::vector<JoinPair>;
+
+namespace join_detail {
+
+// Throw unless `left_keys` and `right_keys` can be compared pairwise.
+void check_join_keys(const Keys& left_keys, const Keys& right_keys) {
+    bool ok = left_keys.size() == right_keys.size();
+    for (size_t i = 0; ok and i < left_keys.size(); ++i) {
+	const auto& a = left_keys[i], &b = right_keys[i];
+	ok = a.type == b.type and a.order == b.order and a.nulls == b.nulls
+	    and (a.type != DataType::FixedString or a.width == b.width);
+    }
+    if (not ok)
+	throw std::runtime_error("merge_join: left and right keys are not compatible");
+}
+
+bool has_null(const uint8_t *row, const Keys& keys) {
+    return std::any_of(keys.begin(), keys.end(), [&](const Key& key) { return key.is_null(row); });
+}
+
+// Return the sort index of `frame` using the fastest engine that
+// supports `keys`.
+std::vector<RowIndex> sort_index(const Frame& frame, const Keys& keys) {
+    auto is_string = [](const Key& key) {
+	return key.type == DataType::String or key.type == DataType::FixedString;
+    };
+    if (std::none_of(keys.begin(), keys.end(), [](const Key& key) { return key.type == DataType::String; }))
+	return radix_index(frame, keys);
+    if (is_string(keys.front()))
+	return string_radix_index(frame, keys);
+    return std_sort_index(frame, keys);
+}
+
+// A frame sorted by its join keys and the original row id of each
+// sorted row.
+struct SortedSide {
+    Frame frame;
+    std::vector<RowIndex> index;
+    Keys keys;
+};
+
+SortedSide sort_side(const Frame& frame, const Keys& keys) {
+    auto bound = bind_heap(frame, keys);
+    auto index = sort_index(frame, bound);
+    auto sorted = frame.order_by(index);
+    return {std::move(sorted), std::move(index), std::move(bound)};
+}
+
+// Merge join the sorted left rows [lbegin, lend) with the sorted right
+// rows [rbegin, rend) appending the pairs to `pairs`. Both sides are
+// read sequentially. Rows with a NULL key never match.
+void merge_range(const SortedSide& left, const SortedSide& right, JoinType type,
+		 size_t lbegin, size_t lend, size_t rbegin, size_t rend, JoinPairs& pairs) {
+    auto unmatched = [&](size_t ldx) {
+	if (type == JoinType::Left)
+	    pairs.push_back({left.index[ldx], JoinPair::NoRow});
+    };
+
+    auto ldx = lbegin, rdx = rbegin;
+    while (ldx < lend) {
+	auto lrow = left.frame.row(ldx);
+	if (has_null(lrow, left.keys)) {
+	    unmatched(ldx++);
+	    continue;
+	}
+
+	while (rdx < rend and compare_rows(right.frame.row(rdx), right.keys, lrow, left.keys) < 0)
+	    ++rdx;
+	auto redx = rdx;
+	while (redx < rend and compare_rows(right.frame.row(redx), right.keys, lrow, left.keys) == 0)
+	    ++redx;
+	auto ledx = ldx + 1;
+	while (ledx < lend and compare_rows(left.frame.row(ledx), left.keys, lrow, left.keys) == 0)
+	    ++ledx;
+
+	for (; ldx < ledx; ++ldx) {
+	    if (rdx == redx) unmatched(ldx);
+	    else if (type == JoinType::Semi) pairs.push_back({left.index[ldx], right.index[rdx]});
+	    else
+		for (auto jdx = rdx; jdx < redx; ++jdx)
+		    pairs.push_back({left.index[ldx], right.index[jdx]});
+	}
+	rdx = redx;
+    }
+}
+
+// Return the first row of `side` that is not less than `row` by `keys`.
+size_t lower_row(const SortedSide& side, const uint8_t *row, const Keys& keys) {
+    size_t lo = 0, hi = side.frame.nrows();
+    while (lo < hi) {
+	auto mid = lo + (hi - lo) / 2;
+	if (compare_rows(side.frame.row(mid), side.keys, row, keys) < 0) lo = mid + 1;
+	else hi = mid;
+    }
+    return lo;
+}
+
+}; // join_detail
+
+// Join `left` and `right` on `left_keys` and `right_keys`, which must
+// correspond pairwise, and return the matching pairs of original row
+// ids ordered by key. Each side is sorted by index and then reordered
+// so the merge reads both frames sequentially. With `nth` > 1 the
+// sides are sorted concurrently and the merge is partitioned by key
+// range across threads.
+JoinPairs merge_join(const Frame& left, const Keys& left_keys,
+		     const Frame& right, const Keys& right_keys,
+		     JoinType type = JoinType::Inner, size_t nth = 1) {
+    using namespace join_detail;
+    check_join_keys(left_keys, right_keys);
+
+    std::optional<SortedSide> sides[2];
+    parallel_for(std::min<size_t>(nth, 2), 2, [&](size_t, size_t begin, size_t end) {
+	for (auto sdx = begin; sdx < end; ++sdx)
+	    sides[sdx] = sdx == 0 ? sort_side(left, left_keys) : sort_side(right, right_keys);
+    });
+    const auto& lside = *sides[0], &rside = *sides[1];
+    const auto nleft = left.nrows();
+
+    // Split the left rows evenly, moving each split forward so a group
+    // of equal keys is never divided, and split the right rows at the
+    // first row not less than the left split.
+    nth = std::clamp<size_t>(nth, 1, std::max<size_t>(1, nleft / 1024));
+    std::vector<size_t> lsplit(nth + 1, nleft), rsplit(nth + 1, right.nrows());
+    lsplit[0] = rsplit[0] = 0;
+    for (size_t tid = 1; tid < nth; ++tid) {
+	auto ldx = std::max(lsplit[tid - 1], tid * nleft / nth);
+	while (ldx > 0 and ldx < nleft and compare_rows(lside.frame.row(ldx - 1), lside.keys,
+							 lside.frame.row(ldx), lside.keys) == 0)
+	    ++ldx;
+	lsplit[tid] = ldx;
+	rsplit[tid] = ldx < nleft ? lower_row(rside, lside.frame.row(ldx), lside.keys) : right.nrows();
+    }
+
+    std::vector<JoinPairs> parts(nth);
+    parallel_for(nth, nth, [&](size_t, size_t begin, size_t end) {
+	for (auto tid = begin; tid < end; ++tid)
+	    merge_range(lside, rside, type, lsplit[tid], lsplit[tid + 1],
+			rsplit[tid], rsplit[tid + 1], parts[tid]);
+    });
+
+    JoinPairs pairs;
+    for (const auto& part : parts)
+	pairs.insert(pairs.end(), part.begin(), part.end());
+    return pairs;
+}
+
+// Return a frame with one row per pair holding the left row followed by
+// the right row. The right half of an unmatched pair is zero filled. If
+// `left_only` is true only the left rows are copied, as for Semi joins.
+Frame join_rows(const Frame& left, const Frame& right, const JoinPairs& pairs, bool left_only = false) {
+    const auto lbpr = left.bytes_per_row(), rbpr = left_only ? 0 : right.bytes_per_row();
+    Frame result(pairs.size(), lbpr + rbpr, false);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+	auto out = std::copy(left.row(pairs[i].left), left.row(pairs[i].left + 1), result.row(i));
+	if (left_only)
+	    continue;
+	if (pairs[i].right == JoinPair::NoRow) std::fill(out, out + rbpr, 0);
+	else std::copy(right.row(pairs[i].right), right.row(pairs[i].right + 1), out);
+    }
+    return result;
+}
+
+}; // core::sort
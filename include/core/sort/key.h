@@ -2,19 +2,77 @@
 //
 
 #pragma once
+#include <cstring>
+#include <stdexcept>
 #include "core/string/split.h"
 #include "type.h"
 
 namespace core::sort {
 
+enum class SortOrder { Ascending, Descending };
+enum class NullOrder { First, Last };
+
+// The source of NULL for a nullable key. For Bitmap, the key is NULL
+// when bit `validity_bit` of the row (counting from the least
+// significant bit of the first byte) is clear. For Sentinel, the key
+// is NULL when the (up to eight) low bytes of the field equal
+// `sentinel`.
+enum class NullSource { None, Bitmap, Sentinel };
+
+// A sort key is a field of `type` at byte `offset` within each row.
+// For FixedString, `width` is the number of bytes in the field. For
+// String, the field is a `StringRef` into the side heap and `heap`
+// must be bound to that heap (see `bind_heap`) before comparing.
+//
+// Each key is sorted in its own `order`. NULLs sort before or after
+// all other values as given by `nulls` regardless of `order`.
 struct Key {
     DataType type;
     size_t offset;
+    size_t width{};
+    const uint8_t *heap{};
+    SortOrder order{SortOrder::Ascending};
+    NullOrder nulls{NullOrder::Last};
+    NullSource null_source{NullSource::None};
+    size_t validity_bit{};
+    uint64_t sentinel{};
+
+    bool descending() const {
+	return order == SortOrder::Descending;
+    }
+
+    bool nullable() const {
+	return null_source != NullSource::None;
+    }
+
+    bool is_null(const uint8_t *row) const {
+	switch (null_source) {
+	case NullSource::None:
+	    return false;
+	case NullSource::Bitmap:
+	    return not ((row[validity_bit / 8] >> (validity_bit % 8)) & 1);
+	case NullSource::Sentinel:
+	    {
+		uint64_t value{};
+		std::memcpy(&value, row + offset, std::min(length(), sizeof(value)));
+		return value == sentinel;
+	    }
+	}
+	return false;
+    }
 
     size_t length() const {
 	switch (type) {
+	case DataType::Signed8:
+	    return 1;
+	case DataType::Signed16:
+	    return 2;
+	case DataType::Signed32:
+	    return 4;
 	case DataType::Signed64:
 	    return 8;
+	case DataType::Signed128:
+	    return 16;
 	case DataType::Unsigned8:
 	    return 1;
 	case DataType::Unsigned16:
@@ -23,25 +81,64 @@ struct Key {
 	    return 4;
 	case DataType::Unsigned64:
 	    return 8;
+	case DataType::Unsigned128:
+	    return 16;
+	case DataType::FixedString:
+	    return width;
+	case DataType::String:
+	    return sizeof(StringRef);
 	}
     }
 };
 
 using Keys = std::vector<Key>;
 
+// Apply the key option `field` (asc, desc, nulls_first, nulls_last,
+// valid=<bit> or sentinel=<value>) to `key`. Returns false if `field`
+// is not an option.
+bool apply_key_option(Key& key, std::string_view field) {
+    using core::str::lexical_cast;
+    if (field == "asc") key.order = SortOrder::Ascending;
+    else if (field == "desc") key.order = SortOrder::Descending;
+    else if (field == "nulls_first") key.nulls = NullOrder::First;
+    else if (field == "nulls_last") key.nulls = NullOrder::Last;
+    else if (field.starts_with("valid=")) {
+	key.null_source = NullSource::Bitmap;
+	key.validity_bit = lexical_cast<uint64_t>(field.substr(6));
+    } else if (field.starts_with("sentinel=")) {
+	key.null_source = NullSource::Sentinel;
+	key.sentinel = lexical_cast<uint64_t>(field.substr(9));
+    } else {
+	return false;
+    }
+    return true;
+}
+
 }; // core::sort
 
 namespace core::str::detail {
 using Key = core::sort::Key;
 template<>
 struct lexical_cast_impl<Key> {
+    // type:offset[:asc|desc][:nulls_first|nulls_last][:valid=<bit>|sentinel=<value>]
     static Key parse(std::string_view s) {
 	auto fields = split(s, ":");
-	if (fields.size() != 2)
+	if (fields.size() < 2)
 	    throw lexical_cast_error(s, "Key");
-	auto data_type = lexical_cast<DataType>(fields[0]);
 	auto offset = lexical_cast<uint64_t>(fields[1]);
-	return Key{data_type, offset};
+
+	Key key{DataType::Unsigned8, offset};
+	if (fields[0].size() > 1 and fields[0][0] == 'c') {
+	    key.type = DataType::FixedString;
+	    key.width = lexical_cast<uint64_t>(fields[0].substr(1));
+	} else {
+	    key.type = lexical_cast<DataType>(fields[0]);
+	}
+
+	for (size_t i = 2; i < fields.size(); ++i)
+	    if (not core::sort::apply_key_option(key, fields[i]))
+		throw lexical_cast_error(s, "Key");
+	return key;
     }
 };
 }; // core::str
@@ -50,6 +147,10 @@ namespace core::sort {
 
 std::ostream& operator<<(std::ostream& os, const Key& key) {
     os << key.type << ":" << (8 * key.length());
+    if (key.descending())
+	os << ":desc";
+    if (key.nullable())
+	os << (key.nulls == NullOrder::First ? ":nulls_first" : ":nulls_last");
     return os;
 }
 
@@ -61,63 +162,90 @@ std::ostream& operator<<(std::ostream& os, const Keys& keys) {
     return os;
 }
 
+// Return the string value of the FixedString or String field for `key`.
+std::string_view string_value(const uint8_t *row, const Key& key) {
+    if (key.type == DataType::FixedString)
+	return {reinterpret_cast<const char*>(row + key.offset), key.width};
+    StringRef ref;
+    std::memcpy(&ref, row + key.offset, sizeof(ref));
+    return {reinterpret_cast<const char*>(key.heap + ref.offset), ref.length};
+}
+
+namespace detail {
+
+template<class T>
+int compare_values(const uint8_t *a_ptr, const uint8_t *b_ptr) {
+    T a, b;
+    std::memcpy(&a, a_ptr, sizeof(a));
+    std::memcpy(&b, b_ptr, sizeof(b));
+    return (a > b) - (a < b);
+}
+
+}; // detail
+
+// Return the three-way comparison in sort order of the field for
+// `a_key` in `a_ptr` and the field for `b_key` in `b_ptr`. The keys
+// must have the same type and order but may have different offsets, so
+// rows of different frames can be compared. NULL compares equal to NULL.
+int compare_field(const uint8_t *a_ptr, const Key& a_key, const uint8_t *b_ptr, const Key& b_key) {
+    if (a_key.nullable() or b_key.nullable()) {
+	bool a_null = a_key.is_null(a_ptr), b_null = b_key.is_null(b_ptr);
+	if (a_null or b_null) {
+	    if (a_null and b_null) return 0;
+	    return a_null == (a_key.nulls == NullOrder::First) ? -1 : 1;
+	}
+    }
+
+    const auto *a = a_ptr + a_key.offset, *b = b_ptr + b_key.offset;
+    int r{};
+    switch (a_key.type) {
+	using enum DataType;
+    case Unsigned8: r = detail::compare_values<uint8_t>(a, b); break;
+    case Unsigned16: r = detail::compare_values<uint16_t>(a, b); break;
+    case Unsigned32: r = detail::compare_values<uint32_t>(a, b); break;
+    case Unsigned64: r = detail::compare_values<uint64_t>(a, b); break;
+    case Unsigned128: r = detail::compare_values<unsigned __int128>(a, b); break;
+    case Signed8: r = detail::compare_values<int8_t>(a, b); break;
+    case Signed16: r = detail::compare_values<int16_t>(a, b); break;
+    case Signed32: r = detail::compare_values<int32_t>(a, b); break;
+    case Signed64: r = detail::compare_values<int64_t>(a, b); break;
+    case Signed128: r = detail::compare_values<__int128>(a, b); break;
+    case FixedString:
+    case String:
+	r = string_value(a_ptr, a_key).compare(string_value(b_ptr, b_key));
+	r = (r > 0) - (r < 0);
+	break;
+    }
+    return a_key.descending() ? -r : r;
+}
+
+// Return the three-way comparison of row `a_ptr` by `a_keys` with row
+// `b_ptr` by `b_keys` where the keys correspond pairwise.
+int compare_rows(const uint8_t *a_ptr, const Keys& a_keys, const uint8_t *b_ptr, const Keys& b_keys) {
+    for (size_t i = 0; i < a_keys.size(); ++i)
+	if (auto r = compare_field(a_ptr, a_keys[i], b_ptr, b_keys[i]))
+	    return r;
+    return 0;
+}
+
 template<class T>
 bool compare(const T *a_raw_ptr, const T *b_raw_ptr, const Keys& sort_keys) {
     const auto *a_ptr = reinterpret_cast<const uint8_t*>(a_raw_ptr);
     const auto *b_ptr = reinterpret_cast<const uint8_t*>(b_raw_ptr);
-    
-    for (const auto& key : sort_keys) {
-	switch (key.type) {
-	    using enum DataType;
-	case Unsigned8:
-	    {
-		auto a = *reinterpret_cast<const uint8_t*>(a_ptr + key.offset);
-		auto b = *reinterpret_cast<const uint8_t*>(b_ptr + key.offset);
-		if (a < b) return true;
-		else if (a > b) return false;
-	    }
-	    break;
-	    
-	case Unsigned16:
-	    {
-		auto a = *reinterpret_cast<const uint16_t*>(a_ptr + key.offset);
-		auto b = *reinterpret_cast<const uint16_t*>(b_ptr + key.offset);
-		if (a < b) return true;
-		else if (a > b) return false;
-	    }
-	    break;
-	    
-	case Unsigned32:
-	    {
-		auto a = *reinterpret_cast<const uint32_t*>(a_ptr + key.offset);
-		auto b = *reinterpret_cast<const uint32_t*>(b_ptr + key.offset);
-		if (a < b) return true;
-		else if (a > b) return false;
-	    }
-	    break;
-	    
-	case Unsigned64:
-	    {
-		auto a = *reinterpret_cast<const uint64_t*>(a_ptr + key.offset);
-		auto b = *reinterpret_cast<const uint64_t*>(b_ptr + key.offset);
-		if (a < b) return true;
-		else if (a > b) return false;
-	    }
-	    break;
-	    
-	case Signed64:
-	    {
-		auto a = *reinterpret_cast<const int64_t*>(a_ptr + key.offset);
-		auto b = *reinterpret_cast<const int64_t*>(b_ptr + key.offset);
-		if (a < b) return true;
-		else if (a > b) return false;
-	    }
-	    break;
-	}
-    }
+    for (const auto& key : sort_keys)
+	if (auto r = compare_field(a_ptr, key, b_ptr, key))
+	    return r < 0;
     return false;
 }
 
+// Throw if any of `keys` cannot be sorted by the fixed-width radix
+// engines.
+void check_radix_keys(const Keys& keys, std::string_view engine) {
+    for (const auto& key : keys)
+	if (key.type == DataType::String)
+	    throw std::runtime_error(std::string(engine) + ": String keys are not supported");
+}
+
 size_t total_key_length(const Keys& keys) {
     size_t n{};
     for (const auto& key : keys)
@@ -125,4 +253,53 @@ size_t total_key_length(const Keys& keys) {
     return n;
 }
 
+// A single byte of the normalized form of `keys` used by the radix
+// engines. The normalized key is the concatenation, for each key, of
+// an optional null digit (ordering NULLs first or last) followed by
+// the big-endian bytes of the value with the sign bit flipped for
+// signed types and all bits complemented for descending keys. The
+// normalized keys compare bytewise exactly as `compare` orders rows.
+struct RadixDigit {
+    Key key;
+    size_t offset{};
+    uint8_t mask{};
+    bool null_digit{};
+
+    uint8_t operator()(const uint8_t *row) const {
+	if (key.nullable()) {
+	    bool null = key.is_null(row);
+	    if (null_digit)
+		return null ? (key.nulls == NullOrder::First ? 0 : 2) : 1;
+	    if (null)
+		return 0;
+	}
+	return row[offset] ^ mask;
+    }
+};
+
+using RadixDigits = std::vector<RadixDigit>;
+
+// Return the digits of the normalized form of `keys`, most
+// significant first.
+RadixDigits radix_digits(const Keys& keys) {
+    check_radix_keys(keys, "radix_digits");
+    RadixDigits digits;
+    for (const auto& key : keys) {
+	if (key.nullable())
+	    digits.push_back(RadixDigit{key, key.offset, 0, true});
+
+	uint8_t mask = key.descending() ? 0xff : 0x00;
+	auto n = key.length();
+	for (size_t i = 0; i < n; ++i) {
+	    if (key.type == DataType::FixedString) {
+		digits.push_back(RadixDigit{key, key.offset + i, mask});
+	    } else {
+		uint8_t sign = i == 0 and is_signed(key.type) ? 0x80 : 0x00;
+		digits.push_back(RadixDigit{key, key.offset + n - 1 - i, uint8_t(mask ^ sign)});
+	    }
+	}
+    }
+    return digits;
+}
+
 }; // core::sort
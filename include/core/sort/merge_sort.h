@@ -3,20 +3,25 @@
 
 #pragma once
 #include <algorithm>
+#include <stdexcept>
 #include "frame.h"
 #include "key.h"
+#include "sort_context.h"
 
 namespace core::sort {
 
-void merge_bottom_up(Frame& frame, const Keys& keys) {
-    Frame buffer = frame;
+// Stable bottom-up merge sort using `buffer`, which has the shape of
+// `frame`, as scratch. Every row of `buffer` is written on each pass
+// so it does not need to be a copy of `frame`.
+void merge_bottom_up(Frame& frame, const Keys& sort_keys, Frame& buffer) {
+    auto keys = bind_heap(frame, sort_keys);
     int n = frame.nrows();
     for (auto w = 1; w < n; w *= 2) {
 	for (auto i = 0, mdx = 0; i < n; i += 2 * w) {
 	    auto lptr = frame.row(i), rptr = frame.row(i + w);
 	    auto elptr = frame.row(std::min(i + w, n)), erptr = frame.row(std::min(i + 2 * w, n));
 	    while (lptr < elptr and rptr < erptr) {
-		if (compare(lptr, rptr, keys) or not compare(rptr, lptr, keys)) {
+		if (not compare(rptr, lptr, keys)) {
 		    std::copy(lptr, lptr + frame.bytes_per_row(), buffer.row(mdx));
 		    lptr += frame.bytes_per_row();
 		    ++mdx;
@@ -41,4 +46,41 @@ void merge_bottom_up(Frame& frame, const Keys& keys) {
     }
 }
 
+void merge_bottom_up(Frame& frame, const Keys& keys) {
+    Frame buffer = frame.empty_clone();
+    merge_bottom_up(frame, keys, buffer);
+}
+
+void merge_bottom_up(Frame& frame, const Keys& keys, SortContext& context) {
+    merge_bottom_up(frame, keys, context.frame_like(frame));
+}
+
+// Return the stable merge of the sorted frames `a` and `b`. Rows with
+// equal keys are taken from `a` first. With String keys both frames
+// must share the same side heap.
+Frame merge(const Frame& a, const Frame& b, const Keys& sort_keys) {
+    bool string_keys = std::any_of(sort_keys.begin(), sort_keys.end(), [](const Key& key) {
+	return key.type == DataType::String;
+    });
+    if (string_keys and a.heap() != b.heap())
+	throw std::runtime_error("merge: String keys require frames sharing a side heap");
+    auto keys = bind_heap(a, sort_keys);
+    Frame result = a.empty_clone();
+    result.resize(a.nrows() + b.nrows());
+    auto lptr = a.begin(), rptr = b.begin();
+    auto out = result.begin();
+    while (lptr < a.end() and rptr < b.end()) {
+	if (not compare(rptr, lptr, keys)) {
+	    out = std::copy(lptr, lptr + a.bytes_per_row(), out);
+	    lptr += a.bytes_per_row();
+	} else {
+	    out = std::copy(rptr, rptr + b.bytes_per_row(), out);
+	    rptr += b.bytes_per_row();
+	}
+    }
+    out = std::copy(lptr, a.end(), out);
+    std::copy(rptr, b.end(), out);
+    return result;
+}
+
 }; // core::sort
@@ -0,0 +1,87 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include "array_ring.h"
+
+namespace core::sort {
+
+// A bounded lock-free queue of up to `Size` elements for any number of
+// producer and consumer threads, using the storage and indices of an
+// `ArrayRing`. Each slot carries a sequence number: a slot at position
+// `pos` is free for the producer that claims `pos` when its sequence
+// is `pos` and holds an element for the consumer that claims `pos`
+// when its sequence is `pos + 1`. Producers and consumers claim
+// positions by compare-and-swap on the head and tail indices, which are
+// on separate cache lines.
+template<class T, size_t Size>
+class MpmcQueue {
+public:
+    static_assert(std::has_single_bit(Size), "MpmcQueue: Size must be a power of two");
+
+    MpmcQueue() {
+	for (size_t idx = 0; idx < Size; ++idx)
+	    ring_[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Push `value` unless the queue is full.
+    bool try_push(const T& value) {
+	std::atomic_ref head(ring_.head_index());
+	auto pos = head.load(std::memory_order_relaxed);
+	while (true) {
+	    auto& cell = ring_[pos];
+	    auto seq = cell.sequence.load(std::memory_order_acquire);
+	    auto diff = intptr_t(seq) - intptr_t(pos);
+	    if (diff == 0) {
+		if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+		    cell.value = value;
+		    cell.sequence.store(pos + 1, std::memory_order_release);
+		    return true;
+		}
+	    } else if (diff < 0) {
+		return false;
+	    } else {
+		pos = head.load(std::memory_order_relaxed);
+	    }
+	}
+    }
+
+    // Pop the oldest available element into `value` unless the queue is
+    // empty.
+    bool try_pop(T& value) {
+	std::atomic_ref tail(ring_.tail_index());
+	auto pos = tail.load(std::memory_order_relaxed);
+	while (true) {
+	    auto& cell = ring_[pos];
+	    auto seq = cell.sequence.load(std::memory_order_acquire);
+	    auto diff = intptr_t(seq) - intptr_t(pos + 1);
+	    if (diff == 0) {
+		if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+		    value = std::move(cell.value);
+		    cell.sequence.store(pos + Size, std::memory_order_release);
+		    return true;
+		}
+	    } else if (diff < 0) {
+		return false;
+	    } else {
+		pos = tail.load(std::memory_order_relaxed);
+	    }
+	}
+    }
+
+private:
+    struct Cell {
+	std::atomic<size_t> sequence;
+	T value;
+    };
+
+    ArrayRing<Cell, Size, 64> ring_;
+};
+
+}; // core::sort
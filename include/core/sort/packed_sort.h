@@ -0,0 +1,68 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include "frame.h"
+#include "key.h"
+#include "qsort.h"
+
+namespace core::sort {
+
+// Return the sort index for `frame` by sorting `Packed` integers
+// (uint64_t or unsigned __int128) that hold the leading bits of the
+// normalized key above the row id. Most of the work is a primitive
+// integer sort. Runs of equal prefixes are then refined by comparing
+// the full keys, which is skipped when the whole key fits in the
+// prefix. Since the row id is the low part of each integer, the index
+// is stable.
+template<class Packed = uint64_t, class Index = RowIndex>
+auto packed_index(const Frame& frame, const Keys& sort_keys) {
+    constexpr size_t PackedBits = 8 * sizeof(Packed);
+    check_radix_keys(sort_keys, "packed_index");
+
+    const auto n = frame.nrows();
+    const size_t id_bits = std::max<size_t>(1, std::bit_width(n));
+    if (id_bits >= PackedBits)
+	throw std::runtime_error("packed_index: too many rows for the packed type");
+    const auto prefix_bits = PackedBits - id_bits;
+    const Packed id_mask = (Packed{1} << id_bits) - 1;
+
+    auto digits = radix_digits(sort_keys);
+    const bool exact = 8 * digits.size() <= prefix_bits;
+    digits.resize(std::min(digits.size(), (prefix_bits + 7) / 8));
+    const auto digit_bits = 8 * digits.size();
+
+    std::vector<Packed> packed(n);
+    for (size_t i = 0; i < n; ++i) {
+	auto row = frame.row(i);
+	Packed prefix{};
+	for (const auto& digit : digits)
+	    prefix = (prefix << 8) | digit(row);
+	if (digit_bits > prefix_bits) prefix >>= digit_bits - prefix_bits;
+	else prefix <<= prefix_bits - digit_bits;
+	packed[i] = (prefix << id_bits) | Packed(i);
+    }
+
+    qsort(packed.begin(), packed.end());
+
+    std::vector<Index> index(n);
+    for (size_t i = 0; i < n; ++i)
+	index[i] = Index(packed[i] & id_mask);
+
+    if (not exact) {
+	for (size_t begin = 0, end; begin < n; begin = end) {
+	    auto prefix = packed[begin] >> id_bits;
+	    for (end = begin + 1; end < n and (packed[end] >> id_bits) == prefix; ++end);
+	    if (end - begin > 1)
+		std::stable_sort(index.begin() + begin, index.begin() + end, [&](Index a, Index b) {
+		    return compare(frame.row(a), frame.row(b), sort_keys);
+		});
+	}
+    }
+    return index;
+}
+
+}; // core::sort
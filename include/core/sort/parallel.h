@@ -0,0 +1,38 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace core::sort {
+
+size_t default_concurrency() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Invoke `work(tid, begin, end)` on `nth` threads where each thread is
+// given a contiguous chunk of [0, n). Chunk boundaries (except the
+// last) are multiples of `align`.
+template<class Work>
+void parallel_for(size_t nth, size_t n, Work&& work, size_t align = 1) {
+    nth = std::clamp<size_t>(nth, 1, std::max<size_t>(1, n / align));
+    if (nth == 1) {
+	work(size_t{0}, size_t{0}, n);
+	return;
+    }
+
+    size_t chunk = (n / nth + align - 1) / align * align;
+    std::vector<std::thread> workers;
+    for (size_t tid = 0; tid < nth; ++tid) {
+	size_t begin = std::min(n, tid * chunk);
+	size_t end = tid + 1 == nth ? n : std::min(n, begin + chunk);
+	workers.emplace_back([&work, tid, begin, end]() { work(tid, begin, end); });
+    }
+
+    for (auto& worker : workers)
+	worker.join();
+}
+
+}; // core::sort
@@ -0,0 +1,150 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include "frame.h"
+#include "key.h"
+#include "insertion_sort.h"
+#include "parallel.h"
+#include "quick_block_sort.h"
+#include "quick_sort.h"
+
+namespace core::sort {
+
+namespace partial_detail {
+
+// Order rows by `keys` and then by row id so that selection is
+// deterministic and agrees with a stable sort.
+auto row_less(const Frame& frame, const Keys& keys) {
+    return [&](RowIndex a, RowIndex b) {
+	auto aptr = frame.row(a), bptr = frame.row(b);
+	if (compare(aptr, bptr, keys)) return true;
+	if (compare(bptr, aptr, keys)) return false;
+	return a < b;
+    };
+}
+
+// Return the (at most) `k` smallest rows in [begin, end) in sorted
+// order using a bounded max-heap.
+std::vector<RowIndex> heap_select(const Frame& frame, const Keys& keys, size_t k,
+			     size_t begin, size_t end) {
+    auto less = row_less(frame, keys);
+    std::vector<RowIndex> heap;
+    heap.reserve(std::min(k, end - begin));
+    for (auto i = begin; i < end and k > 0; ++i) {
+	if (heap.size() < k) {
+	    heap.push_back(i);
+	    std::push_heap(heap.begin(), heap.end(), less);
+	} else if (less(i, heap.front())) {
+	    std::pop_heap(heap.begin(), heap.end(), less);
+	    heap.back() = i;
+	    std::push_heap(heap.begin(), heap.end(), less);
+	}
+    }
+    std::sort_heap(heap.begin(), heap.end(), less);
+    return heap;
+}
+
+// Move the rows `index` (distinct) to the front of `frame` in order.
+// Only the selected rows and the rows they displace are moved.
+void move_to_front(Frame& frame, const std::vector<RowIndex>& index) {
+    const auto k = index.size();
+    Frame top(k, frame.bytes_per_row(), false);
+    std::vector<bool> selected(k);
+    std::vector<RowIndex> vacated;
+    for (size_t i = 0; i < k; ++i) {
+	std::copy(frame.row(index[i]), frame.row(index[i] + 1), top.row(i));
+	if (index[i] < k) selected[index[i]] = true;
+	else vacated.push_back(index[i]);
+    }
+
+    for (size_t i = 0, j = 0; i < k; ++i)
+	if (not selected[i])
+	    std::copy(frame.row(i), frame.row(i + 1), frame.row(vacated[j++]));
+    std::copy(top.begin(), top.end(), frame.row(0));
+}
+
+}; // partial_detail
+
+// Return the row indices of the `k` smallest rows of `frame` in sorted
+// order. Rows with equal keys are ordered by row id. With `nth` > 1,
+// each thread selects the top `k` of its chunk and the candidates are
+// then merged.
+std::vector<RowIndex> top_k_index(const Frame& frame, const Keys& sort_keys, size_t k, size_t nth = 1) {
+    auto keys = bind_heap(frame, sort_keys);
+    const auto n = frame.nrows();
+    k = std::min(k, n);
+    nth = std::clamp<size_t>(nth, 1, std::max<size_t>(1, n / std::max<size_t>(k, 1024)));
+    if (nth == 1)
+	return partial_detail::heap_select(frame, keys, k, 0, n);
+
+    std::vector<std::vector<RowIndex>> candidates(nth);
+    parallel_for(nth, n, [&](size_t tid, size_t begin, size_t end) {
+	candidates[tid] = partial_detail::heap_select(frame, keys, k, begin, end);
+    });
+
+    std::vector<RowIndex> index;
+    for (const auto& chunk : candidates) {
+	auto middle = index.insert(index.end(), chunk.begin(), chunk.end());
+	std::inplace_merge(index.begin(), middle, index.end(),
+			   partial_detail::row_less(frame, keys));
+	index.resize(std::min(index.size(), k));
+    }
+    return index;
+}
+
+// Reorder `frame` so that row `kdx` is the row that would be there if
+// `frame` were sorted, no row before it is greater and no row after it
+// is less. Uses introselect around `quick_sort_partition` and falls
+// back to heap selection when partitioning stops making progress.
+void nth_element(Frame& frame, const Keys& sort_keys, size_t kdx) {
+    constexpr size_t Threshold = 16;
+    const auto n = frame.nrows();
+    if (n == 0 or kdx >= n)
+	return;
+
+    auto keys = bind_heap(frame, sort_keys);
+
+    size_t ldx = 0, rdx = n - 1, kth = kdx;
+    for (auto depth = 2 * std::bit_width(n); rdx - ldx > Threshold; --depth) {
+	if (depth == 0) {
+	    Frame range(1 + rdx - ldx, frame.bytes_per_row(), false);
+	    std::copy(frame.row(ldx), frame.row(rdx + 1), range.begin());
+	    auto index = partial_detail::heap_select(range, keys, 1 + kth - ldx, 0, range.nrows());
+	    partial_detail::move_to_front(range, index);
+	    std::copy(range.begin(), range.end(), frame.row(ldx));
+	    return;
+	}
+
+	size_t pdx = quick_sort_partition(frame, keys, ldx, rdx);
+	if (kth <= pdx) rdx = pdx;
+	else ldx = pdx + 1;
+    }
+    insertion_sort(frame, keys, ldx, rdx + 1);
+}
+
+// Reorder `frame` so that the first `k` rows are the `k` smallest rows
+// in sorted order. The order of the remaining rows is unspecified.
+// Small `k` uses heap selection and moves O(k) rows, otherwise the
+// frame is partitioned with `nth_element` and the prefix sorted.
+void partial_sort(Frame& frame, const Keys& sort_keys, size_t k, size_t nth = 1) {
+    constexpr size_t HeapRatio = 32;
+    const auto n = frame.nrows();
+    k = std::min(k, n);
+    if (k == 0)
+	return;
+
+    auto keys = bind_heap(frame, sort_keys);
+
+    if (k <= n / HeapRatio) {
+	partial_detail::move_to_front(frame, top_k_index(frame, keys, k, nth));
+    } else {
+	nth_element(frame, keys, k - 1);
+	quick_block_sort(frame, keys, 0, k - 1);
+    }
+}
+
+}; // core::sort
@@ -0,0 +1,153 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "frame.h"
+#include "record_file.h"
+#include "spsc_queue.h"
+
+namespace core::sort {
+
+namespace pipeline_detail {
+
+inline constexpr size_t MaxBuffers = 8;
+inline constexpr size_t End = std::numeric_limits<size_t>::max();
+
+using BufferQueue = SpscQueue<size_t, MaxBuffers>;
+
+// Queue operations retried before waiting.
+inline constexpr size_t Spins = 64;
+
+// A count of the pushes, pops and cancellations of a pipeline that the
+// threads block on. A thread takes the count before trying its queue
+// and waits only while it is unchanged, so no change is missed.
+class Signal {
+public:
+    uint32_t count() const {
+	return count_.load(std::memory_order_acquire);
+    }
+
+    void wait(uint32_t seen) const {
+	count_.wait(seen, std::memory_order_acquire);
+    }
+
+    void notify() {
+	count_.fetch_add(1, std::memory_order_release);
+	count_.notify_all();
+    }
+
+private:
+    std::atomic<uint32_t> count_{};
+};
+
+// Push `id` to `queue`, blocking while it is full. Each queue holds
+// every buffer id plus the end marker, so it never stays full.
+void push(BufferQueue& queue, size_t id, Signal& signal) {
+    for (size_t spin = 0; ; ++spin) {
+	auto seen = signal.count();
+	if (queue.try_push(id))
+	    break;
+	if (spin >= Spins)
+	    signal.wait(seen);
+    }
+    signal.notify();
+}
+
+// Pop a buffer id from `queue`, blocking while it is empty. Returns End
+// if `cancel` is set.
+size_t pop(BufferQueue& queue, Signal& signal, const std::atomic<bool>& cancel) {
+    size_t id;
+    for (size_t spin = 0; ; ++spin) {
+	auto seen = signal.count();
+	if (queue.try_pop(id))
+	    break;
+	if (cancel.load(std::memory_order_relaxed))
+	    return End;
+	if (spin >= Spins)
+	    signal.wait(seen);
+    }
+    signal.notify();
+    return id;
+}
+
+}; // pipeline_detail
+
+// Stream `reader` in chunks of up to `chunk_rows` rows through
+// `process(Frame&)` on the calling thread and then `write(const
+// Frame&)` on a writer thread, while a reader thread reads ahead. With
+// the default three buffers, reading chunk i+1, processing chunk i and
+// writing chunk i-1 overlap. The buffers cycle from the reader to the
+// processor to the writer and back through lock-free queues, a thread
+// sleeping while its queue is empty. Chunks are written in order. If
+// any stage throws, the pipeline stops and the first exception, in
+// stage order, is rethrown after all threads are joined.
+template<class Process, class Write>
+void pipeline_chunks(RecordReader& reader, size_t chunk_rows, Process&& process, Write&& write,
+		     size_t nbuffers = 3) {
+    using namespace pipeline_detail;
+    nbuffers = std::clamp<size_t>(nbuffers, 1, MaxBuffers - 1);
+    const auto bpr = reader.schema().bytes_per_row;
+
+    std::vector<Frame> buffers(nbuffers, Frame(0, bpr, false));
+    BufferQueue free, filled, processed;
+    Signal signal;
+    for (size_t id = 0; id < nbuffers; ++id)
+	push(free, id, signal);
+
+    std::atomic<bool> cancel{false};
+    std::exception_ptr errors[3];
+    auto fail = [&](size_t stage) {
+	errors[stage] = std::current_exception();
+	cancel = true;
+	signal.notify();
+    };
+
+    std::thread reader_thread([&]() {
+	try {
+	    for (size_t id; (id = pop(free, signal, cancel)) != End;) {
+		if (reader.read(buffers[id], chunk_rows) == 0)
+		    break;
+		push(filled, id, signal);
+	    }
+	} catch (...) {
+	    fail(0);
+	}
+	push(filled, End, signal);
+    });
+
+    std::thread writer_thread([&]() {
+	try {
+	    for (size_t id; (id = pop(processed, signal, cancel)) != End;) {
+		write(std::as_const(buffers[id]));
+		push(free, id, signal);
+	    }
+	} catch (...) {
+	    fail(2);
+	}
+    });
+
+    try {
+	for (size_t id; (id = pop(filled, signal, cancel)) != End;) {
+	    process(buffers[id]);
+	    push(processed, id, signal);
+	}
+    } catch (...) {
+	fail(1);
+    }
+    push(processed, End, signal);
+
+    reader_thread.join();
+    writer_thread.join();
+    for (const auto& error : errors)
+	if (error)
+	    std::rethrow_exception(error);
+}
+
+}; // core::sort
@@ -5,17 +5,18 @@
 #include <algorithm>
 #include <thread>
 #include <barrier>
+#include <memory>
 #include <vector>
+#include "sort_context.h"
 
 namespace core::sort {
 
-template<class Iter, class Compare>
-void psort_merge(size_t nth, Iter begin, Iter end, Compare cmp) {
-    using value_type = typename Iter::value_type;
+namespace psort_detail {
 
-    size_t ndata = end - begin;
-    std::vector<value_type> tmp_buffer(ndata);
-    Iter tmp_iter = tmp_buffer.begin();
+// Sort the `ndata` elements at `begin` using the same number of
+// elements at `tmp` as the merge buffer.
+template<class T, class Compare>
+void psort_merge(size_t nth, T *begin, size_t ndata, T *tmp_iter, Compare cmp) {
 
     size_t bucketsize = ndata / nth;
     std::barrier sync(nth);
@@ -66,4 +67,22 @@ void psort_merge(size_t nth, Iter begin, Iter end, Compare cmp) {
 	std::copy(begin, begin + ndata, tmp_iter);
 }
 
+}; // psort_detail
+
+template<class Iter, class Compare>
+void psort_merge(size_t nth, Iter begin, Iter end, Compare cmp) {
+    using value_type = typename Iter::value_type;
+    std::vector<value_type, DefaultInitAllocator<value_type>> tmp_buffer(end - begin);
+    psort_detail::psort_merge(nth, std::to_address(begin), tmp_buffer.size(), tmp_buffer.data(), cmp);
+}
+
+// Same as above using vector slot 0 of `context` as the merge buffer.
+template<class Iter, class Compare>
+void psort_merge(size_t nth, Iter begin, Iter end, Compare cmp, SortContext& context) {
+    using value_type = typename Iter::value_type;
+    auto& tmp_buffer = context.vector<value_type>(0);
+    tmp_buffer.resize(end - begin);
+    psort_detail::psort_merge(nth, std::to_address(begin), tmp_buffer.size(), tmp_buffer.data(), cmp);
+}
+
 }; // core::sort
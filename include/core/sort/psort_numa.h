@@ -0,0 +1,188 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <barrier>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "sort_context.h"
+#include "topology.h"
+
+namespace core::sort {
+
+namespace psort_detail {
+
+// Return the node of each of up to `nth` workers. The workers are
+// spread round robin over the nodes of `topology` and then grouped by
+// node, so consecutive workers share a node.
+std::vector<const NumaNode*> numa_workers(const Topology& topology, size_t nth) {
+    std::vector<size_t> count(topology.nodes.size());
+    nth = std::min(nth, topology.ncpus());
+    for (size_t tid = 0, node = 0; tid < nth; node = (node + 1) % count.size())
+	if (count[node] < topology.nodes[node].cpus.size()) {
+	    ++count[node];
+	    ++tid;
+	}
+
+    std::vector<const NumaNode*> workers;
+    for (size_t node = 0; node < count.size(); ++node)
+	workers.insert(workers.end(), count[node], &topology.nodes[node]);
+    return workers;
+}
+
+// Return the number of elements of each of the sorted `runs` that are
+// among the first `k` elements of their merge. Ties are ranked by run
+// and then by position so the split is unique. Each step halves the
+// widest remaining range of candidate positions.
+template<class T, class Compare>
+std::vector<size_t> multiway_split(const std::vector<std::pair<const T*, size_t>>& runs,
+				   size_t k, Compare cmp) {
+    const auto nruns = runs.size();
+    std::vector<size_t> lo(nruns), hi(nruns), pos(nruns);
+    for (size_t r = 0; r < nruns; ++r)
+	hi[r] = runs[r].second;
+
+    while (true) {
+	size_t pivot_run = nruns;
+	for (size_t r = 0; r < nruns; ++r)
+	    if (lo[r] < hi[r] and (pivot_run == nruns or hi[r] - lo[r] > hi[pivot_run] - lo[pivot_run]))
+		pivot_run = r;
+	if (pivot_run == nruns)
+	    return lo;
+
+	auto mid = lo[pivot_run] + (hi[pivot_run] - lo[pivot_run]) / 2;
+	const auto& pivot = runs[pivot_run].first[mid];
+	size_t rank{};
+	for (size_t r = 0; r < nruns; ++r) {
+	    auto *data = runs[r].first;
+	    if (r == pivot_run) pos[r] = mid;
+	    else if (r < pivot_run)
+		pos[r] = std::upper_bound(data + lo[r], data + hi[r], pivot, cmp) - data;
+	    else
+		pos[r] = std::lower_bound(data + lo[r], data + hi[r], pivot, cmp) - data;
+	    rank += pos[r];
+	}
+
+	if (rank <= k) {
+	    for (size_t r = 0; r < nruns; ++r)
+		lo[r] = pos[r];
+	    if (rank < k)
+		lo[pivot_run] = mid + 1;
+	    else
+		return lo;
+	} else {
+	    for (size_t r = 0; r < nruns; ++r)
+		hi[r] = pos[r];
+	}
+    }
+}
+
+// Merge `count` elements of the sorted `runs`, starting at the
+// positions `first`, into `out`. Equal elements are taken from the
+// earlier run first.
+template<class T, class Compare>
+void multiway_merge(const std::vector<std::pair<const T*, size_t>>& runs, std::vector<size_t> first,
+		    const std::vector<size_t>& last, T *out, size_t count, Compare cmp) {
+    auto greater = [&](size_t a, size_t b) {
+	const auto& x = runs[a].first[first[a]], &y = runs[b].first[first[b]];
+	if (cmp(y, x)) return true;
+	if (cmp(x, y)) return false;
+	return a > b;
+    };
+
+    std::vector<size_t> heap;
+    for (size_t r = 0; r < runs.size(); ++r)
+	if (first[r] < last[r])
+	    heap.push_back(r);
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    for (size_t i = 0; i < count; ++i) {
+	std::pop_heap(heap.begin(), heap.end(), greater);
+	auto r = heap.back();
+	out[i] = runs[r].first[first[r]++];
+	if (first[r] < last[r]) std::push_heap(heap.begin(), heap.end(), greater);
+	else heap.pop_back();
+    }
+}
+
+// Sort the `ndata` elements at `begin` using the same number of
+// elements at `tmp` as scratch.
+template<class T, class Compare>
+void psort_numa(const Topology& topology, size_t nth, T *begin, size_t ndata, T *tmp, Compare cmp) {
+    constexpr size_t MinPerThread = 1 << 14;
+    auto workers = numa_workers(topology, std::clamp<size_t>(ndata / MinPerThread, 1, nth));
+    const auto nworkers = workers.size();
+    if (nworkers == 1) {
+	std::sort(begin, begin + ndata, cmp);
+	return;
+    }
+
+    std::vector<std::pair<const T*, size_t>> runs(nworkers);
+    std::vector<std::vector<size_t>> splits(nworkers + 1);
+    std::barrier sync(nworkers);
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < nworkers; ++tid) {
+	threads.emplace_back([&,tid]() {
+	    pin_current_thread(workers[tid]->cpus);
+
+	    // Run formation: copy this worker's partition into scratch
+	    // that it touches first, so the pages are on its node, and
+	    // sort it there.
+	    auto sdx = tid * ndata / nworkers, edx = (tid + 1) * ndata / nworkers;
+	    std::copy(begin + sdx, begin + edx, tmp + sdx);
+	    std::sort(tmp + sdx, tmp + edx, cmp);
+	    runs[tid] = {tmp + sdx, edx - sdx};
+	    sync.arrive_and_wait();
+
+	    // Cross-node merge: each worker writes an equal share of the
+	    // output and reads the matching part of every run.
+	    auto odx = tid * ndata / nworkers, oedx = (tid + 1) * ndata / nworkers;
+	    splits[tid] = multiway_split(runs, odx, cmp);
+	    if (tid + 1 == nworkers) {
+		splits[nworkers].resize(nworkers);
+		for (size_t r = 0; r < nworkers; ++r)
+		    splits[nworkers][r] = runs[r].second;
+	    }
+	    sync.arrive_and_wait();
+	    multiway_merge(runs, splits[tid], splits[tid + 1], begin + odx, oedx - odx, cmp);
+	});
+    }
+
+    for (auto& thread : threads)
+	thread.join();
+}
+
+}; // psort_detail
+
+// Topology-aware parallel sort. The data is split into one contiguous
+// partition per worker with the workers spread evenly over the nodes
+// of `topology` and pinned to their node. Each worker sorts its
+// partition in node-local scratch, and then all workers merge the
+// sorted runs in a single pass, each producing an equal share of the
+// output, so both the remote reads and the merge work are balanced
+// across nodes. At most `nth` workers are used.
+template<class Iter, class Compare>
+void psort_numa(size_t nth, Iter begin, Iter end, Compare cmp,
+		const Topology& topology = Topology::system()) {
+    using value_type = typename Iter::value_type;
+    std::vector<value_type, DefaultInitAllocator<value_type>> tmp_buffer(end - begin);
+    psort_detail::psort_numa(topology, nth, std::to_address(begin), tmp_buffer.size(),
+			     tmp_buffer.data(), cmp);
+}
+
+// Same as above using vector slot 0 of `context` as the scratch. The
+// pages stay on the nodes that first touched them, so the context
+// should be reused with the same topology and similar sizes.
+template<class Iter, class Compare>
+void psort_numa(size_t nth, Iter begin, Iter end, Compare cmp, SortContext& context,
+		const Topology& topology = Topology::system()) {
+    using value_type = typename Iter::value_type;
+    auto& tmp_buffer = context.vector<value_type>(0);
+    tmp_buffer.resize(end - begin);
+    psort_detail::psort_numa(topology, nth, std::to_address(begin), tmp_buffer.size(),
+			     tmp_buffer.data(), cmp);
+}
+
+}; // core::sort
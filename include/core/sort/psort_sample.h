@@ -5,25 +5,26 @@
 #include <algorithm>
 #include <latch>
 #include <thread>
+#include <vector>
+#include "sort_context.h"
 
 namespace core::sort {
 
-template<class Iter, class Compare, size_t SampleBlock = 64>
-void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp) {
-    if (nth == 1) {
-	std::sort(begin, end, cmp);
-	return;
-    }
+namespace psort_detail {
 
-    using value_type = typename Iter::value_type;
+// Sample sort using `sample`, `pivots` and the `nth` per-thread
+// vectors `tmp` as scratch. The vectors are cleared before use.
+template<size_t SampleBlock, class Iter, class Compare, class Vector>
+void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp,
+		  Vector& sample, Vector& pivots, Vector **tmp) {
     size_t ndata = end - begin;
     
-    std::vector<value_type> sample;
+    sample.clear();
     for (auto i = 0; i < ndata; i += SampleBlock)
 	sample.push_back(begin[i]);
     std::sort(sample.begin(), sample.end(), cmp);
 	
-    std::vector<value_type> pivots;
+    pivots.clear();
     auto sample_ratio = (double)sample.size() / nth;
     for (auto i = 1; i < nth; ++i)
 	pivots.push_back(sample[i * sample_ratio]);
@@ -33,7 +34,8 @@ void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp) {
     std::latch sync_copy(nth);
     for (auto tid = 0; tid < nth; ++tid) {
 	threads.emplace_back([&,tid]() {
-	    std::vector<value_type> tmp_data;
+	    auto& tmp_data = *tmp[tid];
+	    tmp_data.clear();
 	    for (auto i = 0; i < ndata; ++i)
 		if ((tid == 0 or begin[i] >= pivots[tid-1]) and
 		    (tid == nth - 1 or begin[i] < pivots[tid]))
@@ -53,4 +55,40 @@ void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp) {
 	worker.join();
 }
 
+}; // psort_detail
+
+template<class Iter, class Compare, size_t SampleBlock = 64>
+void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp) {
+    if (nth == 1) {
+	std::sort(begin, end, cmp);
+	return;
+    }
+
+    using value_type = typename Iter::value_type;
+    std::vector<value_type> sample, pivots;
+    std::vector<std::vector<value_type>> tmp_data(nth);
+    std::vector<std::vector<value_type>*> tmp;
+    for (auto& data : tmp_data)
+	tmp.push_back(&data);
+    psort_detail::psort_sample<SampleBlock>(nth, begin, end, cmp, sample, pivots, tmp.data());
+}
+
+// Same as above using vector slots 0 and 1 of `context` for the
+// sample and pivots and slots 2 to `nth` + 1 for the per-thread data.
+template<class Iter, class Compare, size_t SampleBlock = 64>
+void psort_sample(size_t nth, Iter begin, Iter end, Compare cmp, SortContext& context) {
+    if (nth == 1) {
+	std::sort(begin, end, cmp);
+	return;
+    }
+
+    using value_type = typename Iter::value_type;
+    std::vector<ScratchVector<value_type>*> tmp;
+    for (size_t tid = 0; tid < nth; ++tid)
+	tmp.push_back(&context.vector<value_type>(2 + tid));
+    psort_detail::psort_sample<SampleBlock>(nth, begin, end, cmp,
+					    context.vector<value_type>(0),
+					    context.vector<value_type>(1), tmp.data());
+}
+
 }; // core::sort
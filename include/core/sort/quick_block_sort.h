@@ -35,9 +35,9 @@ int quick_block_sort_partition(Frame& frame, const Keys& keys, int ldx, int rdx)
 }
 
 void quick_block_sort(Frame& frame, const Keys& keys, int ldx, int rdx) {
-    conditional_swap cswap(conditional_swap([&](auto x, auto y) {
+    conditional_swap cswap{[&](auto x, auto y) {
      	return compare(x, y, keys);
-    }));
+    }};
 
     const auto bpr = frame.bytes_per_row();
     constexpr auto InsertionThreshold = 32;
@@ -47,18 +47,18 @@ void quick_block_sort(Frame& frame, const Keys& keys, int ldx, int rdx) {
 
 	auto lsize = 1 + pdx - ldx;
 	if (lsize < FixedThreshold) fixed_sortUpTo8(frame.row(ldx), lsize, bpr, cswap);
-	else if (lsize < InsertionThreshold) insertion_sort(frame, keys, ldx, pdx);
+	else if (lsize < InsertionThreshold) insertion_sort(frame, keys, ldx, pdx + 1);
 	else quick_block_sort(frame, keys, ldx, pdx);
 
 	auto rsize = rdx - pdx;
 	if (rsize < FixedThreshold) fixed_sortUpTo8(frame.row(pdx + 1), rdx - pdx, bpr, cswap);
-	else if (rsize < InsertionThreshold) insertion_sort(frame, keys, pdx + 1, rdx);
+	else if (rsize < InsertionThreshold) insertion_sort(frame, keys, pdx + 1, rdx + 1);
 	else quick_block_sort(frame, keys, pdx + 1, rdx);
     }
 }
    
 void quick_block_sort(Frame& frame, const Keys& keys) {
-    quick_block_sort(frame, keys, 0, frame.nrows() - 1);
+    quick_block_sort(frame, bind_heap(frame, keys), 0, frame.nrows() - 1);
 }
 
 }; // core::sort
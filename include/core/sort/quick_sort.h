@@ -42,17 +42,17 @@ void quick_sort(Frame& frame, const Keys& keys, int ldx, int rdx) {
 	auto pdx = quick_sort_partition(frame, keys, ldx, rdx);
 	
 	if (1 + pdx - ldx > Threshold) quick_sort(frame, keys, ldx, pdx);
-	else insertion_sort(frame, keys, ldx, pdx);
+	else insertion_sort(frame, keys, ldx, pdx + 1);
 	// else fixed_sortUpTo8(frame.row(ldx), 1 + pdx - ldx, frame.bytes_per_row(), cswap);
 	
 	if (rdx - pdx > Threshold) quick_sort(frame, keys, pdx + 1, rdx);
-	else insertion_sort(frame, keys, pdx + 1, rdx);
+	else insertion_sort(frame, keys, pdx + 1, rdx + 1);
 	// else fixed_sortUpTo8(frame.row(pdx + 1), rdx - pdx, frame.bytes_per_row(), cswap);
     }
 }
    
 void quick_sort(Frame& frame, const Keys& keys) {
-    quick_sort(frame, keys, 0, frame.nrows() - 1);
+    quick_sort(frame, bind_heap(frame, keys), 0, frame.nrows() - 1);
 }
 
 }; // core::sort
@@ -5,111 +5,93 @@
 #include <algorithm>
 #include "frame.h"
 #include "key.h"
+#include "scatter.h"
+#include "sort_context.h"
 
 namespace core::sort {
 
-auto radix_mem_index(Frame& frame, const Keys& sort_keys) {
-    using RadixIndex = int;
+namespace radix_mem_detail {
+
+// Sort into `index` using `new_index`, `buckets` and `planes` as
+// scratch.
+template<class Index, class IndexVector, class BucketVector, class PlaneVector>
+void radix_mem_index(const Frame& frame, const Keys& sort_keys, IndexVector& index,
+		     IndexVector& new_index, BucketVector& buckets, PlaneVector& planes,
+		     size_t prefetch) {
     constexpr auto RadixSize = 257;
-    using SortIndex = std::vector<int>;
     
-    Keys keys = sort_keys;
-    std::reverse(keys.begin(), keys.end());
+    check_radix_keys(sort_keys, "radix_mem_index");
+    auto digits = radix_digits(sort_keys);
+    std::reverse(digits.begin(), digits.end());
     
-    const auto key_length = total_key_length(keys);
-    RadixIndex buckets[key_length][RadixSize];
-    memset(buckets, 0, key_length * RadixSize * sizeof(RadixIndex));
-
-    std::vector<std::vector<uint8_t>> radix_values(key_length);
-    for (auto i = 0; i < key_length; ++i)
-	radix_values[i].resize(frame.nrows());
+    const auto key_length = digits.size();
+    const auto stride = (frame.nrows() + 63) / 64 * 64;
+    buckets.assign(key_length * RadixSize, 0);
+    planes.resize(stride * key_length);
 
-    for (auto i = 0; i < frame.nrows(); ++i) {
+    for (size_t i = 0; i < frame.nrows(); ++i) {
 	auto row = frame.row(i);
-	auto bdx = 0;
-	for (const auto& key : keys) {
-	    auto field = row + key.offset;
-	    switch (key.type) {
-		using enum DataType;
-	    case Unsigned8:
-		radix_values[bdx][i] = field[0];
-		++buckets[bdx][1 + field[0]];
-		++bdx;
-		break;
-	    case Unsigned16:
-		for (auto j = 0; j < 2; ++j, ++bdx) {
-		    radix_values[bdx][i] = field[j];
-		    ++buckets[bdx][1 + field[j]];
-		}
-		break;
-	    case Unsigned32:
-		for (auto j = 0; j < 4; ++j, ++bdx) {
-		    radix_values[bdx][i] = field[j];
-		    ++buckets[bdx][1 + field[j]];
-		}
-		break;
-	    case Unsigned64:
-		for (auto j = 0; j < 8; ++j, ++bdx) {
-		    radix_values[bdx][i] = field[j];
-		    ++buckets[bdx][1 + field[j]];
-		}
-		break;
-	    case Signed64:
-		for (auto j = 0; j < 8; ++j, ++bdx) {
-		    radix_values[bdx][i] = field[j];
-		    ++buckets[bdx][1 + field[j]];
-		}
-		break;
-	    }
+	for (size_t bdx = 0; bdx < key_length; ++bdx) {
+	    auto value = digits[bdx](row);
+	    planes[bdx * stride + i] = value;
+	    ++buckets[bdx * RadixSize + 1 + value];
 	}
     }
 
-    SortIndex index(frame.nrows()), new_index(frame.nrows());
-    for (auto i = 0; i < frame.nrows(); ++i)
+    index.resize(frame.nrows());
+    new_index.resize(frame.nrows());
+    for (size_t i = 0; i < frame.nrows(); ++i)
 	index[i] = i;
 
-    auto bdx = 0;
-    for (const auto& key : keys) {
-	switch (key.type) {
-	    using enum DataType;
-	case Unsigned8:
-	case Unsigned16:
-	case Unsigned32:
-	case Unsigned64:
-	    for (auto i = 0; i < key.length(); ++i, ++bdx) {
-		auto *counts = buckets[bdx];
-		for (auto j = 1; j < RadixSize; ++j)
-		    counts[j] += counts[j - 1];
+    const auto nrows = frame.nrows();
+    WriteCombiner<Index> out(new_index.data(), buckets.data(), RadixSize - 1);
+    for (size_t bdx = 0; bdx < key_length; ++bdx) {
+	auto *counts = &buckets[bdx * RadixSize];
+	for (auto j = 1; j < RadixSize; ++j)
+	    counts[j] += counts[j - 1];
 		
-		auto *values = radix_values[bdx].data();
-		for (auto j = 0; j < frame.nrows(); ++j) {
-		    auto value = values[index[j]];
-		    auto& loc = counts[value];
-		    new_index[loc] = index[j];
-		    ++loc;
-		}
-		std::swap(index, new_index);
-	    }
-	    break;
-	case Signed64:
-	    for (auto i = 0; i < key.length(); ++i, ++bdx) {
-		auto *counts = buckets[bdx];
-		for (auto j = 1; j < RadixSize; ++j)
-		    counts[j] += counts[j - 1];
-		
-		auto *values = radix_values[bdx].data();
-		for (auto j = 0; j < frame.nrows(); ++j) {
-		    auto value = values[index[j]];
-		    auto& loc = counts[value];
-		    new_index[loc] = index[j];
-		    ++loc;
-		}
-		std::swap(index, new_index);
-	    }
-	    break;
+	const auto *values = planes.data() + bdx * stride;
+	out.reset(new_index.data(), counts);
+	for (size_t j = 0; j < nrows; ++j) {
+	    if (j + prefetch < nrows)
+		__builtin_prefetch(values + index[j + prefetch]);
+	    out.push(values[index[j]], index[j]);
 	}
+	out.flush();
+	std::swap(index, new_index);
     }
+}
+
+}; // radix_mem_detail
+
+// Return the sort index for `frame` using LSD radix sort. Each pass is
+// a counting sort, so the index is stable: rows with equal keys keep
+// their original relative order. `Index` must be able to hold the
+// number of rows. The digits are extracted in a single pass over the
+// rows, which also builds the histograms, into one allocation holding
+// a plane of digits per pass. Each plane is padded to a whole number of
+// cache lines so a pass gathers from a dense `nrows` byte array. The
+// digit gathers are prefetched `prefetch` elements ahead and the
+// scatter writes through per-bucket write-combining buffers.
+template<class Index = RowIndex>
+auto radix_mem_index(const Frame& frame, const Keys& sort_keys,
+		     size_t prefetch = RadixPrefetchDistance) {
+    std::vector<Index> index, new_index, buckets;
+    Frame::storage_type planes;
+    radix_mem_detail::radix_mem_index<Index>(frame, sort_keys, index, new_index, buckets,
+					     planes, prefetch);
+    return index;
+}
 
+// As above, but all memory comes from `context`. The returned index
+// is valid until `context` is next used.
+template<class Index = RowIndex>
+const auto& radix_mem_index(const Frame& frame, const Keys& sort_keys, SortContext& context,
+			    size_t prefetch = RadixPrefetchDistance) {
+    auto& index = context.vector<Index>(0);
+    radix_mem_detail::radix_mem_index<Index>(frame, sort_keys, index, context.vector<Index>(1),
+					     context.vector<Index>(2), context.vector<uint8_t>(3),
+					     prefetch);
     return index;
 }
 
@@ -5,56 +5,54 @@
 #include <algorithm>
 #include "frame.h"
 #include "key.h"
+#include "sort_context.h"
 
 namespace core::sort {
 
-void radix_msb_sort(Frame& frame, const Keys& sort_keys) {
-    using RadixIndex = int;
+// LSD radix sort of the rows of `frame` using `buffer`, which has the
+// shape of `frame`, and `raw_key` as scratch.
+template<class DigitVector>
+void radix_msb_sort(Frame& frame, const Keys& sort_keys, Frame& buffer, DigitVector& raw_key) {
+    using RadixIndex = size_t;
     constexpr auto RadixSize = 257;
 
-    Frame buffer = frame.empty_clone();
-    std::vector<RadixIndex> raw_key(frame.nrows());
-    for (const auto& key : sort_keys) {
-	for (auto kdx = 0; kdx < key.length(); ++kdx) {
-	    RadixIndex buckets[RadixSize];
-	    memset(buckets, 0, RadixSize * sizeof(RadixIndex));
-
-	    for (auto i = 0; i < frame.nrows(); ++i) {
-		switch (key.type) {
-		    using enum DataType;
-		case Unsigned8:
-		case Unsigned16:
-		case Unsigned32:
-		case Unsigned64:
-		    {
-			auto value = frame[i, key.offset + key.length() - kdx - 1];
-			++buckets[1 + value];
-			raw_key[i] = value;
-			break;
-		    }
-		case Signed64:
-		    {
-			auto value = frame[i, key.offset + key.length() - kdx - 1];
-			++buckets[1 + value];
-			raw_key[i] = value;
-			break;
-		    }
-		}
-	    }
-
-	    for (auto i = 1; i < RadixSize; ++i)
-		buckets[i] += buckets[i - 1];
-
-	    for (auto i = 0; i < frame.nrows(); ++i) {
-		auto value = raw_key[i];
-		auto& loc = buckets[value];
-		std::copy(frame.row(i), frame.row(i+1), buffer.row(loc));
-		++loc;
-	    }
-
-	    std::swap(buffer, frame);
+    check_radix_keys(sort_keys, "radix_msb_sort");
+    auto digits = radix_digits(sort_keys);
+    std::reverse(digits.begin(), digits.end());
+
+    raw_key.resize(frame.nrows());
+    for (const auto& digit : digits) {
+	RadixIndex buckets[RadixSize];
+	memset(buckets, 0, RadixSize * sizeof(RadixIndex));
+
+	for (size_t i = 0; i < frame.nrows(); ++i) {
+	    auto value = digit(frame.row(i));
+	    ++buckets[1 + value];
+	    raw_key[i] = value;
+	}
+
+	for (auto i = 1; i < RadixSize; ++i)
+	    buckets[i] += buckets[i - 1];
+
+	for (size_t i = 0; i < frame.nrows(); ++i) {
+	    auto value = raw_key[i];
+	    auto& loc = buckets[value];
+	    std::copy(frame.row(i), frame.row(i+1), buffer.row(loc));
+	    ++loc;
 	}
+
+	std::swap(buffer, frame);
     }
 }
 
+void radix_msb_sort(Frame& frame, const Keys& sort_keys) {
+    Frame buffer = frame.empty_clone();
+    std::vector<uint8_t> raw_key;
+    radix_msb_sort(frame, sort_keys, buffer, raw_key);
+}
+
+void radix_msb_sort(Frame& frame, const Keys& sort_keys, SortContext& context) {
+    radix_msb_sort(frame, sort_keys, context.frame_like(frame), context.vector<uint8_t>(0));
+}
+
 }; // core::sort
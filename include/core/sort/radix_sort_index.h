@@ -5,98 +5,81 @@
 #include <algorithm>
 #include "frame.h"
 #include "key.h"
+#include "scatter.h"
+#include "sort_context.h"
 
 namespace core::sort {
 
-auto radix_index(Frame& frame, const Keys& sort_keys) {
-    using RadixIndex = int;
-    constexpr auto RadixSize = 257;
+namespace radix_index_detail {
 
-    using SortIndex = std::vector<RadixIndex>;
+// Sort into `index` using `new_index` and `buckets` as scratch.
+template<class Index, class IndexVector, class BucketVector>
+void radix_index(const Frame& frame, const Keys& sort_keys, IndexVector& index,
+		 IndexVector& new_index, BucketVector& buckets, size_t prefetch) {
+    constexpr auto RadixSize = 257;
     
-    Keys keys = sort_keys;
-    std::reverse(keys.begin(), keys.end());
+    check_radix_keys(sort_keys, "radix_index");
+    auto digits = radix_digits(sort_keys);
+    std::reverse(digits.begin(), digits.end());
     
-    const auto key_length = total_key_length(keys);
-    RadixIndex buckets[key_length][RadixSize];
-    memset(buckets, 0, key_length * RadixSize * sizeof(RadixIndex));
+    const auto key_length = digits.size();
+    buckets.assign(key_length * RadixSize, 0);
 
-    for (auto i = 0; i < frame.nrows(); ++i) {
+    for (size_t i = 0; i < frame.nrows(); ++i) {
 	auto row = frame.row(i);
-	auto bdx = 0;
-	for (const auto& key : keys) {
-	    auto field = row + key.offset;
-	    switch (key.type) {
-		using enum DataType;
-	    case Unsigned8:
-		++buckets[bdx++][1 + field[0]];
-		break;
-	    case Unsigned16:
-		for (auto i = 0; i < 2; ++i)
-		    ++buckets[bdx++][1 + field[i]];
-		break;
-	    case Unsigned32:
-		for (auto i = 0; i < 4; ++i)
-		    ++buckets[bdx++][1 + field[i]];
-		break;
-	    case Unsigned64:
-		for (auto i = 0; i < 8; ++i)
-		    ++buckets[bdx++][1 + field[i]];
-		break;
-	    case Signed64:
-		for (auto i = 0; i < 8; ++i)
-		    ++buckets[bdx++][1 + field[i]];
-		break;
-	    }
-	}
+	for (size_t bdx = 0; bdx < key_length; ++bdx)
+	    ++buckets[bdx * RadixSize + 1 + digits[bdx](row)];
     }
 
-    for (auto i = 0; i < key_length; ++i) {
-	auto *counts = buckets[i];
-	for (auto j = 1; j < 257; ++j)
+    for (size_t i = 0; i < key_length; ++i) {
+	auto *counts = &buckets[i * RadixSize];
+	for (auto j = 1; j < RadixSize; ++j)
 	    counts[j] += counts[j - 1];
     }
 
-    SortIndex index(frame.nrows()), new_index(frame.nrows());
-    for (auto i = 0; i < frame.nrows(); ++i)
+    index.resize(frame.nrows());
+    new_index.resize(frame.nrows());
+    for (size_t i = 0; i < frame.nrows(); ++i)
 	index[i] = i;
 
-    auto bdx = 0;
-    for (const auto& key : keys) {
-	switch (key.type) {
-	    using enum DataType;
-	case Unsigned8:
-	case Unsigned16:
-	case Unsigned32:
-	case Unsigned64:
-	    for (auto i = 0; i < key.length(); ++i) {
-		auto *counts = buckets[bdx++];
-		auto offset = key.offset + i;
-		for (auto j = 0; j < frame.nrows(); ++j) {
-		    auto value = frame[index[j], offset];
-		    auto& loc = counts[value];
-		    new_index[loc] = index[j];
-		    ++loc;
-		}
-		std::swap(index, new_index);
-	    }
-	    break;
-	case Signed64:
-	    for (auto i = 0; i < key.length(); ++i) {
-		auto *counts = buckets[bdx++];
-		auto offset = key.offset + i;
-		for (auto j = 0; j < frame.nrows(); ++j) {
-		    auto value = frame[index[j], offset];
-		    auto& loc = counts[value];
-		    new_index[loc] = index[j];
-		    ++loc;
-		}
-		std::swap(index, new_index);
-	    }
-	    break;
+    const auto nrows = frame.nrows();
+    WriteCombiner<Index> out(new_index.data(), buckets.data(), RadixSize - 1);
+    for (size_t bdx = 0; bdx < key_length; ++bdx) {
+	const auto& digit = digits[bdx];
+	out.reset(new_index.data(), &buckets[bdx * RadixSize]);
+	for (size_t j = 0; j < nrows; ++j) {
+	    if (j + prefetch < nrows)
+		__builtin_prefetch(frame.row(index[j + prefetch]) + digit.offset);
+	    out.push(digit(frame.row(index[j])), index[j]);
 	}
+	out.flush();
+	std::swap(index, new_index);
     }
+}
+
+}; // radix_index_detail
+
+// Return the sort index for `frame` using LSD radix sort. Each pass is
+// a counting sort, so the index is stable: rows with equal keys keep
+// their original relative order. `Index` must be able to hold the
+// number of rows. The scatter prefetches the row `prefetch` elements
+// ahead and writes through per-bucket write-combining buffers.
+template<class Index = RowIndex>
+auto radix_index(const Frame& frame, const Keys& sort_keys,
+		 size_t prefetch = RadixPrefetchDistance) {
+    std::vector<Index> index, new_index, buckets;
+    radix_index_detail::radix_index<Index>(frame, sort_keys, index, new_index, buckets, prefetch);
+    return index;
+}
 
+// As above, but all memory comes from `context`. The returned index
+// is valid until `context` is next used.
+template<class Index = RowIndex>
+const auto& radix_index(const Frame& frame, const Keys& sort_keys, SortContext& context,
+			size_t prefetch = RadixPrefetchDistance) {
+    auto& index = context.vector<Index>(0);
+    radix_index_detail::radix_index<Index>(frame, sort_keys, index, context.vector<Index>(1),
+					   context.vector<Index>(2), prefetch);
     return index;
 }
 
@@ -0,0 +1,309 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "key.h"
+
+namespace core::sort {
+
+// None    -- Rows are stored as is.
+// Packed  -- Rows are stored in blocks, each field bit-packed by
+//            `RecordCodec`.
+enum class RecordCompression : uint32_t { None, Packed };
+
+namespace codec_detail {
+
+// Each block field is stored as one of
+//
+//   Raw    -- the values as is, when packing does not save space.
+//   Frame  -- the values less the block minimum in `bits` bits each.
+//   Delta  -- the first value and the zigzag differences of
+//             consecutive values less their minimum in `bits` bits
+//             each, which suits the sorted leading key of a run.
+//   Runs   -- the number of runs of equal values and each value with
+//             its run length, which suits sorted keys with many
+//             duplicates.
+enum class Mode : uint8_t { Raw, Frame, Delta, Runs };
+
+// Packed values are read and written as unaligned 64-bit words shifted
+// by up to seven bits, which bounds the packed width.
+inline constexpr size_t MaxBits = 57;
+
+// Bytes readable past the end of a packed field.
+inline constexpr size_t Slack = 8;
+
+// An integer of `width` bytes at `offset` in each row. Signed values
+// have their sign bit flipped by `flip` so the values are ordered as
+// unsigned integers.
+struct Field {
+    size_t offset, width;
+    uint64_t flip;
+};
+
+template<size_t W>
+uint64_t load(const uint8_t *ptr) {
+    uint64_t value{};
+    std::memcpy(&value, ptr, W);
+    return value;
+}
+
+template<size_t W>
+void store(uint8_t *ptr, uint64_t value) {
+    std::memcpy(ptr, &value, W);
+}
+
+inline uint64_t zigzag(uint64_t delta) {
+    return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+
+inline uint64_t unzigzag(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+template<class T>
+void put(std::vector<uint8_t>& out, T value) {
+    auto size = out.size();
+    out.resize(size + sizeof(T));
+    std::memcpy(out.data() + size, &value, sizeof(T));
+}
+
+template<class T>
+T get(const uint8_t *& ptr) {
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return value;
+}
+
+// Append `values` packed in `bits` bits each.
+inline void pack(const std::vector<uint64_t>& values, size_t begin, uint64_t base, size_t bits,
+		 std::vector<uint8_t>& out) {
+    auto size = out.size();
+    auto nbytes = ((values.size() - begin) * bits + 7) / 8;
+    out.resize(size + nbytes + Slack);
+    std::fill(out.begin() + size, out.end(), 0);
+    auto *ptr = out.data() + size;
+    for (size_t i = begin, bit = 0; i < values.size(); ++i, bit += bits) {
+	auto word = load<8>(ptr + bit / 8) | ((values[i] - base) << (bit % 8));
+	store<8>(ptr + bit / 8, word);
+    }
+    out.resize(size + nbytes);
+}
+
+template<size_t W>
+void encode_field(const uint8_t *rows, size_t nrows, size_t bpr, const Field& field,
+		  std::vector<uint64_t>& values, std::vector<uint64_t>& deltas, std::vector<uint8_t>& out) {
+    values.resize(nrows);
+    deltas.resize(nrows);
+    for (size_t i = 0; i < nrows; ++i)
+	values[i] = load<W>(rows + i * bpr + field.offset) ^ field.flip;
+    for (size_t i = 1; i < nrows; ++i)
+	deltas[i] = zigzag(values[i] - values[i - 1]);
+
+    auto [vmin, vmax] = std::minmax_element(values.begin(), values.end());
+    auto frame_base = *vmin;
+    auto frame_bits = size_t(std::bit_width(*vmax - *vmin));
+    uint64_t delta_base{};
+    auto delta_bits = std::numeric_limits<size_t>::max();
+    if (nrows > 1) {
+	auto [dmin, dmax] = std::minmax_element(deltas.begin() + 1, deltas.end());
+	delta_base = *dmin;
+	delta_bits = std::bit_width(*dmax - *dmin);
+    }
+
+    size_t nruns{1};
+    for (size_t i = 1; i < nrows; ++i)
+	nruns += values[i] != values[i - 1];
+
+    auto packed_bits = std::min(frame_bits, delta_bits);
+    if (nruns * 8 * (W + sizeof(uint32_t)) < nrows * std::min(packed_bits, 8 * W)) {
+	put(out, Mode::Runs);
+	put(out, uint32_t(nruns));
+	for (size_t i = 0, length = 1; i < nrows; ++i, ++length) {
+	    if (i + 1 == nrows or values[i + 1] != values[i]) {
+		auto size = out.size();
+		out.resize(size + W);
+		store<W>(out.data() + size, values[i] ^ field.flip);
+		put(out, uint32_t(length));
+		length = 0;
+	    }
+	}
+    } else if (packed_bits > std::min(MaxBits, 8 * W - 1)) {
+	put(out, Mode::Raw);
+	for (size_t i = 0; i < nrows; ++i)
+	    for (size_t j = 0; j < W; ++j)
+		out.push_back(rows[i * bpr + field.offset + j]);
+    } else if (frame_bits <= delta_bits) {
+	put(out, Mode::Frame);
+	put(out, uint8_t(frame_bits));
+	put(out, frame_base);
+	pack(values, 0, frame_base, frame_bits, out);
+    } else {
+	put(out, Mode::Delta);
+	put(out, uint8_t(delta_bits));
+	put(out, delta_base);
+	put(out, values[0]);
+	pack(deltas, 1, delta_base, delta_bits, out);
+    }
+}
+
+template<size_t W>
+const uint8_t *decode_field(const uint8_t *in, const uint8_t *end, size_t nrows, size_t bpr, const Field& field,
+			    uint8_t *rows) {
+    auto check = [&](size_t nbytes) {
+	if (size_t(end - in) < nbytes)
+	    throw std::runtime_error("RecordCodec: truncated block");
+    };
+    check(1);
+    auto mode = get<Mode>(in);
+    if (mode == Mode::Raw) {
+	check(nrows * W);
+	for (size_t i = 0; i < nrows; ++i, in += W)
+	    std::memcpy(rows + i * bpr + field.offset, in, W);
+	return in;
+    } else if (mode == Mode::Runs) {
+	check(sizeof(uint32_t));
+	auto nruns = get<uint32_t>(in);
+	check(nruns * (W + sizeof(uint32_t)));
+	auto *out = rows + field.offset;
+	auto *last = out + nrows * bpr;
+	for (uint32_t run = 0; run < nruns; ++run) {
+	    const auto *value = in;
+	    in += W;
+	    auto length = get<uint32_t>(in);
+	    if (length > size_t(last - out) / bpr)
+		throw std::runtime_error("RecordCodec: corrupt block");
+	    for (; length > 0; --length, out += bpr)
+		std::memcpy(out, value, W);
+	}
+	if (out != last)
+	    throw std::runtime_error("RecordCodec: corrupt block");
+	return in;
+    }
+
+    check(1 + sizeof(uint64_t));
+    auto bits = get<uint8_t>(in);
+    auto base = get<uint64_t>(in);
+    if (bits > MaxBits or mode > Mode::Runs)
+	throw std::runtime_error("RecordCodec: corrupt block");
+    auto mask = bits == 0 ? 0 : ~uint64_t{0} >> (64 - bits);
+    auto *out = rows + field.offset;
+    if (mode == Mode::Frame) {
+	check((nrows * bits + 7) / 8);
+	for (size_t i = 0, bit = 0; i < nrows; ++i, bit += bits, out += bpr)
+	    store<W>(out, (((load<8>(in + bit / 8) >> (bit % 8)) & mask) + base) ^ field.flip);
+    } else {
+	check(sizeof(uint64_t) + ((nrows - 1) * bits + 7) / 8);
+	auto value = get<uint64_t>(in);
+	store<W>(out, value ^ field.flip);
+	out += bpr;
+	for (size_t i = 1, bit = 0; i < nrows; ++i, bit += bits, out += bpr) {
+	    value += unzigzag(((load<8>(in + bit / 8) >> (bit % 8)) & mask) + base);
+	    store<W>(out, value ^ field.flip);
+	}
+	--nrows;
+    }
+    return in + (nrows * bits + 7) / 8;
+}
+
+}; // codec_detail
+
+// Lightweight compression of blocks of rows with a given layout. Each
+// integer column, and each half of a String reference, is a field of
+// the block; every other byte, such as those of a FixedString, is a
+// one-byte field. Each field is stored either as the offsets of its
+// values from the block minimum or as the differences of consecutive
+// values, whichever packs into fewer bits, so the sorted leading key
+// of a run and constant or narrow columns shrink to a few bits per row.
+// A field with long runs of equal values is stored as the runs.
+// Decoding is branch-free within a field.
+class RecordCodec {
+public:
+    RecordCodec() = default;
+
+    // A codec for rows of `bytes_per_row` bytes holding the fields of
+    // `layout`, one key per column.
+    RecordCodec(size_t bytes_per_row, const Keys& layout)
+	: bpr_(bytes_per_row) {
+	using namespace codec_detail;
+	std::vector<bool> covered(bpr_);
+	auto add = [&](size_t offset, size_t width, bool is_signed) {
+	    if (offset + width > bpr_ or std::any_of(covered.begin() + offset, covered.begin() + offset + width,
+						     [](bool b) { return b; }))
+		return;
+	    std::fill(covered.begin() + offset, covered.begin() + offset + width, true);
+	    fields_.push_back({offset, width, is_signed ? uint64_t{1} << (8 * width - 1) : 0});
+	};
+
+	for (const auto& column : layout) {
+	    switch (column.type) {
+		using enum DataType;
+	    case FixedString:
+		break;
+	    case String:
+		add(column.offset, sizeof(uint32_t), false);
+		add(column.offset + sizeof(uint32_t), sizeof(uint32_t), false);
+		break;
+	    case Signed128:
+	    case Unsigned128:
+		add(column.offset, 8, false);
+		add(column.offset + 8, 8, is_signed(column.type));
+		break;
+	    default:
+		add(column.offset, column.length(), is_signed(column.type));
+		break;
+	    }
+	}
+	for (size_t offset = 0; offset < bpr_; ++offset)
+	    if (not covered[offset])
+		fields_.push_back({offset, 1, 0});
+	std::sort(fields_.begin(), fields_.end(), [](const Field& a, const Field& b) {
+	    return a.offset < b.offset;
+	});
+    }
+
+    // Append the encoding of the `nrows` rows at `rows` to `out`.
+    void encode(const uint8_t *rows, size_t nrows, std::vector<uint8_t>& out) {
+	using namespace codec_detail;
+	if (nrows == 0)
+	    return;
+	for (const auto& field : fields_) {
+	    switch (field.width) {
+	    case 1: encode_field<1>(rows, nrows, bpr_, field, values_, deltas_, out); break;
+	    case 2: encode_field<2>(rows, nrows, bpr_, field, values_, deltas_, out); break;
+	    case 4: encode_field<4>(rows, nrows, bpr_, field, values_, deltas_, out); break;
+	    default: encode_field<8>(rows, nrows, bpr_, field, values_, deltas_, out); break;
+	    }
+	}
+    }
+
+    // Decode `nrows` rows from the `nbytes` bytes at `in`, which must be
+    // followed by `Slack` readable bytes, into `rows`.
+    void decode(const uint8_t *in, size_t nbytes, size_t nrows, uint8_t *rows) const {
+	using namespace codec_detail;
+	if (nrows == 0)
+	    return;
+	const auto *end = in + nbytes;
+	for (const auto& field : fields_) {
+	    switch (field.width) {
+	    case 1: in = decode_field<1>(in, end, nrows, bpr_, field, rows); break;
+	    case 2: in = decode_field<2>(in, end, nrows, bpr_, field, rows); break;
+	    case 4: in = decode_field<4>(in, end, nrows, bpr_, field, rows); break;
+	    default: in = decode_field<8>(in, end, nrows, bpr_, field, rows); break;
+	    }
+	}
+    }
+
+private:
+    size_t bpr_{};
+    std::vector<codec_detail::Field> fields_;
+    std::vector<uint64_t> values_, deltas_;
+};
+
+}; // core::sort
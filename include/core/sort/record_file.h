@@ -0,0 +1,690 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include "allocator.h"
+#include "frame.h"
+#include "key.h"
+#include "record_codec.h"
+
+namespace core::sort {
+
+// A record file holds the rows of a `Frame` with a self-describing
+// header. All integers are little-endian.
+//
+//   offset  size  field
+//   0       8     magic "CSORTREC"
+//   8       4     version
+//   12      4     number of columns
+//   16      8     number of rows
+//   24      8     bytes per row
+//   32      8     bytes of String heap
+//   40      8     offset of the first row, a multiple of RecordAlign
+//   48      4     compression, zero for none
+//   52      4     reserved, zero
+//   56      8     bytes of row data, as stored
+//   64            columns, each:
+//                   1 type, 1 reserved, 2 name length, 4 offset,
+//                   8 width, name
+//
+// The rows follow at the data offset and the String heap, which
+// `StringRef` fields refer to, follows the rows. Packed rows are
+// stored as a sequence of blocks, each a 4 byte row count, a 4 byte
+// length and the rows encoded by `RecordCodec`.
+inline constexpr char RecordMagic[8] = {'C', 'S', 'O', 'R', 'T', 'R', 'E', 'C'};
+inline constexpr uint32_t RecordVersion = 1;
+inline constexpr size_t RecordAlign = 4096;
+inline constexpr size_t RecordHeaderSize = 64;
+inline constexpr size_t RecordBlockBytes = size_t{1} << 18;
+
+// A named, typed field of each row. `width` is the number of bytes of
+// a FixedString.
+struct Column {
+    std::string name;
+    DataType type;
+    size_t offset;
+    size_t width{};
+
+    Key key() const {
+	return Key{type, offset, width};
+    }
+
+    bool operator==(const Column&) const = default;
+};
+
+struct Schema {
+    size_t bytes_per_row{};
+    std::vector<Column> columns;
+
+    const Column& column(std::string_view name) const {
+	for (const auto& column : columns)
+	    if (column.name == name)
+		return column;
+	throw std::runtime_error(fmt::format("Schema: no column named '{}'", name));
+    }
+
+    // Return the key for `spec`, a column name optionally followed by
+    // key options as in "name:desc:nulls_first:valid=3".
+    Key key(std::string_view spec) const {
+	auto fields = core::str::split(spec, ":");
+	auto key = column(fields.at(0)).key();
+	for (size_t i = 1; i < fields.size(); ++i)
+	    if (not apply_key_option(key, fields[i]))
+		throw std::runtime_error(fmt::format("Schema: bad key option '{}' in '{}'", fields[i], spec));
+	return key;
+    }
+
+    Keys keys(const std::vector<std::string>& specs) const {
+	Keys keys;
+	for (const auto& spec : specs)
+	    keys.push_back(key(spec));
+	return keys;
+    }
+
+    bool operator==(const Schema&) const = default;
+};
+
+struct RecordHeader {
+    Schema schema;
+    size_t nrows{};
+    size_t heap_bytes{};
+    size_t data_offset{};
+    RecordCompression compression{RecordCompression::None};
+    size_t data_bytes{};
+};
+
+// Buffered   -- Ordinary reads and writes through the page cache.
+// Direct     -- O_DIRECT with aligned buffers, bypassing the page cache.
+//               Falls back to Buffered where O_DIRECT is not supported.
+enum class RecordIo { Buffered, Direct };
+
+namespace record_detail {
+
+using Buffer = std::vector<uint8_t, AlignedAllocator<uint8_t, RecordAlign>>;
+
+size_t align_up(size_t n, size_t align = RecordAlign) {
+    return (n + align - 1) / align * align;
+}
+
+template<class T>
+void put(Buffer& buffer, size_t offset, T value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<class T>
+T get(const uint8_t *ptr, size_t offset) {
+    T value;
+    std::memcpy(&value, ptr + offset, sizeof(T));
+    return value;
+}
+
+// Return the encoded header padded to its data offset.
+Buffer encode_header(const RecordHeader& header) {
+    const auto& schema = header.schema;
+    size_t nbytes = RecordHeaderSize;
+    for (const auto& column : schema.columns)
+	nbytes += 16 + column.name.size();
+
+    Buffer buffer(align_up(nbytes));
+    std::fill(buffer.begin(), buffer.end(), 0);
+    std::memcpy(buffer.data(), RecordMagic, sizeof(RecordMagic));
+    put<uint32_t>(buffer, 8, RecordVersion);
+    put<uint32_t>(buffer, 12, schema.columns.size());
+    put<uint64_t>(buffer, 16, header.nrows);
+    put<uint64_t>(buffer, 24, schema.bytes_per_row);
+    put<uint64_t>(buffer, 32, header.heap_bytes);
+    put<uint64_t>(buffer, 40, buffer.size());
+    put<uint32_t>(buffer, 48, uint32_t(header.compression));
+    put<uint64_t>(buffer, 56, header.data_bytes);
+
+    size_t offset = RecordHeaderSize;
+    for (const auto& column : schema.columns) {
+	if (column.name.size() > UINT16_MAX)
+	    throw std::runtime_error(fmt::format("record file: column name too long: {}", column.name));
+	put<uint8_t>(buffer, offset, uint8_t(column.type));
+	put<uint16_t>(buffer, offset + 2, column.name.size());
+	put<uint32_t>(buffer, offset + 4, column.offset);
+	put<uint64_t>(buffer, offset + 8, column.width);
+	std::memcpy(buffer.data() + offset + 16, column.name.data(), column.name.size());
+	offset += 16 + column.name.size();
+    }
+    return buffer;
+}
+
+// Decode the header from the first `nbytes` bytes at `ptr`. Returns
+// false if more bytes are needed.
+bool decode_header(const uint8_t *ptr, size_t nbytes, RecordHeader& header, std::string_view path) {
+    if (nbytes < RecordHeaderSize)
+	return false;
+    if (std::memcmp(ptr, RecordMagic, sizeof(RecordMagic)) != 0)
+	throw std::runtime_error(fmt::format("{}: not a record file", path));
+    if (auto version = get<uint32_t>(ptr, 8); version != RecordVersion)
+	throw std::runtime_error(fmt::format("{}: unsupported record file version {}", path, version));
+
+    auto ncolumns = get<uint32_t>(ptr, 12);
+    header.nrows = get<uint64_t>(ptr, 16);
+    header.schema.bytes_per_row = get<uint64_t>(ptr, 24);
+    header.heap_bytes = get<uint64_t>(ptr, 32);
+    header.data_offset = get<uint64_t>(ptr, 40);
+    header.compression = RecordCompression(get<uint32_t>(ptr, 48));
+    header.data_bytes = header.compression == RecordCompression::None
+	? header.nrows * header.schema.bytes_per_row
+	: get<uint64_t>(ptr, 56);
+    if (header.compression > RecordCompression::Packed)
+	throw std::runtime_error(fmt::format("{}: unsupported record file compression {}", path,
+					     uint32_t(header.compression)));
+    if (header.data_offset > nbytes)
+	return false;
+
+    header.schema.columns.clear();
+    size_t offset = RecordHeaderSize;
+    for (uint32_t i = 0; i < ncolumns; ++i) {
+	if (offset + 16 > header.data_offset)
+	    throw std::runtime_error(fmt::format("{}: corrupt record file schema", path));
+	Column column;
+	column.type = DataType(get<uint8_t>(ptr, offset));
+	auto length = get<uint16_t>(ptr, offset + 2);
+	column.offset = get<uint32_t>(ptr, offset + 4);
+	column.width = get<uint64_t>(ptr, offset + 8);
+	if (offset + 16 + length > header.data_offset or column.type > DataType::String
+	    or column.offset + column.key().length() > header.schema.bytes_per_row)
+	    throw std::runtime_error(fmt::format("{}: corrupt record file schema", path));
+	column.name.assign(reinterpret_cast<const char*>(ptr + offset + 16), length);
+	header.schema.columns.push_back(std::move(column));
+	offset += 16 + length;
+    }
+    return true;
+}
+
+// Return the codec for packed rows of `schema`.
+RecordCodec make_codec(const Schema& schema) {
+    Keys layout;
+    for (const auto& column : schema.columns)
+	layout.push_back(column.key());
+    return RecordCodec(schema.bytes_per_row, layout);
+}
+
+// Open `path` with `flags`, adding O_DIRECT for Direct io if the file
+// system supports it. Sets `direct` to whether O_DIRECT is in effect.
+int open_file(const std::string& path, int flags, RecordIo io, bool& direct) {
+    direct = false;
+#ifdef O_DIRECT
+    if (io == RecordIo::Direct) {
+	if (auto fd = ::open(path.c_str(), flags | O_DIRECT, 0644); fd >= 0) {
+	    direct = true;
+	    return fd;
+	}
+    }
+#endif
+    auto fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0)
+	throw std::runtime_error(fmt::format("{}: cannot open: {}", path, std::strerror(errno)));
+    return fd;
+}
+
+// Read up to `nbytes` at `offset`. Returns the number of bytes read,
+// which is less than `nbytes` only at the end of the file.
+size_t read_at(int fd, uint8_t *ptr, size_t nbytes, size_t offset, std::string_view path) {
+    size_t total{};
+    while (total < nbytes) {
+	auto n = ::pread(fd, ptr + total, nbytes - total, offset + total);
+	if (n < 0 and errno == EINTR)
+	    continue;
+	if (n < 0)
+	    throw std::runtime_error(fmt::format("{}: read failed: {}", path, std::strerror(errno)));
+	if (n == 0)
+	    break;
+	total += n;
+    }
+    return total;
+}
+
+void write_at(int fd, const uint8_t *ptr, size_t nbytes, size_t offset, std::string_view path) {
+    size_t total{};
+    while (total < nbytes) {
+	auto n = ::pwrite(fd, ptr + total, nbytes - total, offset + total);
+	if (n < 0 and errno == EINTR)
+	    continue;
+	if (n < 0)
+	    throw std::runtime_error(fmt::format("{}: write failed: {}", path, std::strerror(errno)));
+	total += n;
+    }
+}
+
+}; // record_detail
+
+// A read-only memory map of a record file. The rows are used in place
+// without copying.
+class MappedRecordFile {
+public:
+    explicit MappedRecordFile(const std::string& path)
+	: path_(path) {
+	bool direct;
+	auto fd = record_detail::open_file(path, O_RDONLY, RecordIo::Buffered, direct);
+	struct stat st;
+	if (::fstat(fd, &st) != 0 or st.st_size == 0) {
+	    ::close(fd);
+	    throw std::runtime_error(fmt::format("{}: not a record file", path));
+	}
+	size_ = st.st_size;
+	auto *ptr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (ptr == MAP_FAILED)
+	    throw std::runtime_error(fmt::format("{}: mmap failed: {}", path, std::strerror(errno)));
+	data_ = static_cast<const uint8_t*>(ptr);
+
+	try {
+	    if (not record_detail::decode_header(data_, size_, header_, path)
+		or header_.data_offset + header_.data_bytes + header_.heap_bytes > size_)
+		throw std::runtime_error(fmt::format("{}: truncated record file", path));
+	    if (header_.compression != RecordCompression::None)
+		throw std::runtime_error(fmt::format("{}: packed record files cannot be mapped", path));
+	} catch (...) {
+	    ::munmap(ptr, size_);
+	    throw;
+	}
+	::madvise(ptr, size_, MADV_SEQUENTIAL);
+    }
+
+    MappedRecordFile(const MappedRecordFile&) = delete;
+    MappedRecordFile& operator=(const MappedRecordFile&) = delete;
+
+    ~MappedRecordFile() {
+	::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+
+    const RecordHeader& header() const {
+	return header_;
+    }
+
+    const Schema& schema() const {
+	return header_.schema;
+    }
+
+    size_t nrows() const {
+	return header_.nrows;
+    }
+
+    size_t bytes_per_row() const {
+	return header_.schema.bytes_per_row;
+    }
+
+    const ElementType *row(size_t idx) const {
+	return data_ + header_.data_offset + idx * bytes_per_row();
+    }
+
+    const ElementType *begin() const {
+	return row(0);
+    }
+
+    const ElementType *end() const {
+	return row(nrows());
+    }
+
+    // Return the String heap, or nullptr if there is none.
+    const ElementType *heap() const {
+	return header_.heap_bytes ? end() : nullptr;
+    }
+
+    // Return a copy of the rows as a frame, with its own String heap.
+    Frame frame(PagePolicy policy = PagePolicy::Default) const {
+	Frame frame(nrows(), bytes_per_row(), false, policy);
+	std::copy(begin(), end(), frame.begin());
+	if (header_.heap_bytes)
+	    frame.add_string({reinterpret_cast<const char*>(heap()), header_.heap_bytes});
+	return frame;
+    }
+
+private:
+    std::string path_;
+    const uint8_t *data_{};
+    size_t size_{};
+    RecordHeader header_;
+};
+
+// Sequential reader of a record file in chunks of rows. Packed rows are
+// decoded a block at a time.
+class RecordReader {
+public:
+    RecordReader(const std::string& path, RecordIo io = RecordIo::Buffered,
+		 size_t buffer_bytes = size_t{1} << 22)
+	: path_(path)
+	, fd_(record_detail::open_file(path, O_RDONLY, io, direct_))
+	, buffer_(record_detail::align_up(std::max<size_t>(buffer_bytes, RecordAlign))) {
+	try {
+	    size_t nbytes{};
+	    while (true) {
+		auto n = record_detail::read_at(fd_, buffer_.data() + nbytes, buffer_.size() - nbytes,
+						nbytes, path_);
+		nbytes += n;
+		if (record_detail::decode_header(buffer_.data(), nbytes, header_, path_))
+		    break;
+		if (n == 0)
+		    throw std::runtime_error(fmt::format("{}: truncated record file", path_));
+		if (nbytes == buffer_.size())
+		    buffer_.resize(2 * buffer_.size());
+	    }
+	    if (header_.heap_bytes)
+		load_heap();
+	    if (header_.compression != RecordCompression::None)
+		codec_ = record_detail::make_codec(header_.schema);
+	    file_offset_ = header_.data_offset;
+	} catch (...) {
+	    ::close(fd_);
+	    throw;
+	}
+    }
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    ~RecordReader() {
+	::close(fd_);
+    }
+
+    const RecordHeader& header() const {
+	return header_;
+    }
+
+    const Schema& schema() const {
+	return header_.schema;
+    }
+
+    bool direct() const {
+	return direct_;
+    }
+
+    // Return the number of rows not yet read.
+    size_t remaining() const {
+	return header_.nrows - nread_;
+    }
+
+    // Read up to `max_rows` rows into `chunk`, which is resized to the
+    // number read, and return that number, zero at the end of the file.
+    // String fields of `chunk` refer to the heap of the file.
+    size_t read(Frame& chunk, size_t max_rows) {
+	const auto bpr = header_.schema.bytes_per_row;
+	if (chunk.bytes_per_row() != bpr)
+	    chunk = Frame(0, bpr, false, chunk.policy());
+	auto nrows = std::min(max_rows, remaining());
+	chunk.resize(nrows);
+	chunk.share_heap(heap_);
+
+	if (header_.compression == RecordCompression::None) {
+	    read_bytes(chunk.begin(), nrows * bpr);
+	} else {
+	    for (size_t idx = 0; idx < nrows;) {
+		if (block_idx_ == block_rows_)
+		    read_block();
+		auto n = std::min(nrows - idx, block_rows_ - block_idx_);
+		std::memcpy(chunk.row(idx), block_.data() + block_idx_ * bpr, n * bpr);
+		block_idx_ += n;
+		idx += n;
+	    }
+	}
+	nread_ += nrows;
+	return nrows;
+    }
+
+private:
+    // Copy the next `nbytes` bytes of row data to `out`.
+    void read_bytes(uint8_t *out, size_t nbytes) {
+	while (nbytes > 0) {
+	    if (begin_ == end_)
+		fill();
+	    auto n = std::min(nbytes, end_ - begin_);
+	    std::memcpy(out, buffer_.data() + begin_, n);
+	    begin_ += n;
+	    out += n;
+	    nbytes -= n;
+	}
+    }
+
+    // Read and decode the next block of packed rows.
+    void read_block() {
+	uint32_t sizes[2];
+	read_bytes(reinterpret_cast<uint8_t*>(sizes), sizeof(sizes));
+	auto [nrows, nbytes] = sizes;
+	if (nrows == 0 or nrows > header_.nrows - ndecoded_)
+	    throw std::runtime_error(fmt::format("{}: corrupt record file block", path_));
+	encoded_.resize(nbytes + codec_detail::Slack);
+	read_bytes(encoded_.data(), nbytes);
+	block_.resize(nrows * header_.schema.bytes_per_row);
+	try {
+	    codec_.decode(encoded_.data(), nbytes, nrows, block_.data());
+	} catch (const std::runtime_error& error) {
+	    throw std::runtime_error(fmt::format("{}: {}", path_, error.what()));
+	}
+	block_idx_ = 0;
+	block_rows_ = nrows;
+	ndecoded_ += nrows;
+    }
+
+    // Read the next block of the file into the buffer. Reads start and
+    // end on RecordAlign boundaries as required by O_DIRECT.
+    void fill() {
+	auto aligned = file_offset_ / RecordAlign * RecordAlign;
+	auto n = record_detail::read_at(fd_, buffer_.data(), buffer_.size(), aligned, path_);
+	if (n <= file_offset_ - aligned)
+	    throw std::runtime_error(fmt::format("{}: truncated record file", path_));
+	begin_ = file_offset_ - aligned;
+	end_ = n;
+	file_offset_ = aligned + n;
+    }
+
+    void load_heap() {
+	auto offset = header_.data_offset + header_.data_bytes;
+	auto aligned = offset / RecordAlign * RecordAlign;
+	record_detail::Buffer buffer(record_detail::align_up(offset - aligned + header_.heap_bytes));
+	auto n = record_detail::read_at(fd_, buffer.data(), buffer.size(), aligned, path_);
+	if (n < offset - aligned + header_.heap_bytes)
+	    throw std::runtime_error(fmt::format("{}: truncated record file", path_));
+	heap_.add_string({reinterpret_cast<const char*>(buffer.data() + offset - aligned),
+			  header_.heap_bytes});
+    }
+
+    std::string path_;
+    bool direct_;
+    int fd_;
+    record_detail::Buffer buffer_;
+    size_t begin_{}, end_{}, file_offset_{}, nread_{};
+    RecordHeader header_;
+    Frame heap_{0, 1, false};
+    RecordCodec codec_;
+    std::vector<uint8_t> encoded_, block_;
+    size_t block_idx_{}, block_rows_{}, ndecoded_{};
+};
+
+// Sequential writer of a record file. The header is rewritten with the
+// final row count and heap size by `close`, which the destructor calls
+// if needed. With Packed compression rows are encoded in blocks of
+// about RecordBlockBytes.
+class RecordWriter {
+public:
+    RecordWriter(const std::string& path, Schema schema, RecordIo io = RecordIo::Buffered,
+		 size_t buffer_bytes = size_t{1} << 22,
+		 RecordCompression compression = RecordCompression::None)
+	: path_(path)
+	, fd_(record_detail::open_file(path, O_WRONLY | O_CREAT | O_TRUNC, io, direct_))
+	, buffer_(record_detail::align_up(std::max<size_t>(buffer_bytes, RecordAlign))) {
+	header_.schema = std::move(schema);
+	header_.compression = compression;
+	if (compression != RecordCompression::None) {
+	    codec_ = record_detail::make_codec(header_.schema);
+	    block_rows_ = std::max<size_t>(1, RecordBlockBytes / header_.schema.bytes_per_row);
+	    block_.reserve(block_rows_ * header_.schema.bytes_per_row);
+	}
+	auto encoded = record_detail::encode_header(header_);
+	header_.data_offset = encoded.size();
+	file_offset_ = header_.data_offset;
+	for (const auto& column : header_.schema.columns)
+	    if (column.type == DataType::String)
+		string_columns_.push_back(column.offset);
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    ~RecordWriter() {
+	if (fd_ >= 0) {
+	    try {
+		close();
+	    } catch (...) {
+	    }
+	}
+    }
+
+    bool direct() const {
+	return direct_;
+    }
+
+    size_t nrows() const {
+	return header_.nrows;
+    }
+
+    // Append the rows of `frame`. String fields are copied into the
+    // heap of the file and their references rewritten, which throws
+    // once the heap outgrows a `StringRef` offset.
+    void write(const Frame& frame) {
+	const auto bpr = header_.schema.bytes_per_row;
+	if (frame.bytes_per_row() != bpr)
+	    throw std::runtime_error(fmt::format("{}: expected {} bytes per row, got {}",
+						 path_, bpr, frame.bytes_per_row()));
+	if (string_columns_.empty()) {
+	    put_rows(frame.begin(), frame.nrows());
+	} else {
+	    std::vector<uint8_t> row(bpr);
+	    for (size_t i = 0; i < frame.nrows(); ++i) {
+		std::copy(frame.row(i), frame.row(i + 1), row.begin());
+		for (auto offset : string_columns_) {
+		    StringRef ref;
+		    std::memcpy(&ref, row.data() + offset, sizeof(ref));
+		    auto *str = frame.heap() + ref.offset;
+		    ref = make_string_ref(heap_.size(), ref.length);
+		    heap_.insert(heap_.end(), str, str + ref.length);
+		    std::memcpy(row.data() + offset, &ref, sizeof(ref));
+		}
+		put_rows(row.data(), 1);
+	    }
+	}
+	header_.nrows += frame.nrows();
+    }
+
+    // Write the heap and the final header and close the file.
+    void close() {
+	if (fd_ < 0)
+	    return;
+	flush_block();
+	header_.heap_bytes = heap_.size();
+	append(heap_.data(), heap_.size());
+
+	auto length = file_offset_ + nbuffer_;
+	if (nbuffer_ > 0) {
+	    auto n = direct_ ? record_detail::align_up(nbuffer_) : nbuffer_;
+	    std::fill(buffer_.data() + nbuffer_, buffer_.data() + n, 0);
+	    record_detail::write_at(fd_, buffer_.data(), n, file_offset_, path_);
+	}
+	auto encoded = record_detail::encode_header(header_);
+	record_detail::write_at(fd_, encoded.data(), encoded.size(), 0, path_);
+	if (::ftruncate(fd_, length) != 0)
+	    throw std::runtime_error(fmt::format("{}: truncate failed: {}", path_, std::strerror(errno)));
+	::close(fd_);
+	fd_ = -1;
+    }
+
+private:
+    // Append `nrows` rows at `ptr` as is or to the block being packed.
+    void put_rows(const uint8_t *ptr, size_t nrows) {
+	const auto bpr = header_.schema.bytes_per_row;
+	if (header_.compression == RecordCompression::None) {
+	    append(ptr, nrows * bpr);
+	    header_.data_bytes += nrows * bpr;
+	    return;
+	}
+	while (nrows > 0) {
+	    auto n = std::min(nrows, block_rows_ - block_.size() / bpr);
+	    block_.insert(block_.end(), ptr, ptr + n * bpr);
+	    ptr += n * bpr;
+	    nrows -= n;
+	    if (block_.size() == block_rows_ * bpr)
+		flush_block();
+	}
+    }
+
+    // Encode and append the rows of the block being packed, if any.
+    void flush_block() {
+	if (block_.empty())
+	    return;
+	auto nrows = block_.size() / header_.schema.bytes_per_row;
+	encoded_.resize(2 * sizeof(uint32_t));
+	codec_.encode(block_.data(), nrows, encoded_);
+	auto nbytes = encoded_.size() - 2 * sizeof(uint32_t);
+	if (nbytes > UINT32_MAX)
+	    throw std::runtime_error(fmt::format("{}: packed block too large", path_));
+	uint32_t sizes[2] = {uint32_t(nrows), uint32_t(nbytes)};
+	std::memcpy(encoded_.data(), sizes, sizeof(sizes));
+	append(encoded_.data(), encoded_.size());
+	header_.data_bytes += encoded_.size();
+	block_.clear();
+    }
+
+    // Copy `nbytes` at `ptr` to the buffer writing each full buffer.
+    void append(const uint8_t *ptr, size_t nbytes) {
+	while (nbytes > 0) {
+	    auto n = std::min(nbytes, buffer_.size() - nbuffer_);
+	    std::memcpy(buffer_.data() + nbuffer_, ptr, n);
+	    nbuffer_ += n;
+	    ptr += n;
+	    nbytes -= n;
+	    if (nbuffer_ == buffer_.size()) {
+		record_detail::write_at(fd_, buffer_.data(), nbuffer_, file_offset_, path_);
+		file_offset_ += nbuffer_;
+		nbuffer_ = 0;
+	    }
+	}
+    }
+
+    std::string path_;
+    bool direct_;
+    int fd_;
+    record_detail::Buffer buffer_;
+    size_t nbuffer_{}, file_offset_{};
+    RecordHeader header_;
+    std::vector<size_t> string_columns_;
+    std::vector<uint8_t> heap_;
+    RecordCodec codec_;
+    std::vector<uint8_t> block_, encoded_;
+    size_t block_rows_{};
+};
+
+// Write `frame` to the record file `path` with `schema`.
+void write_record_file(const std::string& path, const Frame& frame, const Schema& schema,
+		       RecordIo io = RecordIo::Buffered,
+		       RecordCompression compression = RecordCompression::None) {
+    RecordWriter writer(path, schema, io, size_t{1} << 22, compression);
+    writer.write(frame);
+    writer.close();
+}
+
+// Read the record file `path` into a frame. If `schema` is non-null it
+// is set to the schema of the file.
+Frame read_record_file(const std::string& path, Schema *schema = nullptr,
+		       RecordIo io = RecordIo::Buffered) {
+    RecordReader reader(path, io);
+    if (schema)
+	*schema = reader.schema();
+    Frame frame(0, reader.schema().bytes_per_row, false);
+    reader.read(frame, reader.remaining());
+    return frame;
+}
+
+}; // core::sort
@@ -0,0 +1,174 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "frame.h"
+#include "key.h"
+
+namespace core::sort {
+
+namespace replacement_detail {
+
+// A row of the heap at `slot` of the work frame.
+struct Entry {
+    uint64_t prefix, seq;
+    RowIndex slot;
+    uint32_t run;
+};
+
+// Restore the heap property of `heap` below `idx` for the strict weak
+// order `less`, the least element first.
+template<class Less>
+void sift_down(std::vector<Entry>& heap, size_t idx, Less&& less) {
+    const auto n = heap.size();
+    auto value = heap[idx];
+    while (true) {
+	auto child = 2 * idx + 1;
+	if (child >= n)
+	    break;
+	if (child + 1 < n and less(heap[child + 1], heap[child]))
+	    ++child;
+	if (not less(heap[child], value))
+	    break;
+	heap[idx] = heap[child];
+	idx = child;
+    }
+    heap[idx] = value;
+}
+
+}; // replacement_detail
+
+// Generate sorted runs by `keys` from the rows returned by `read(Frame&,
+// size_t max_rows)`, which returns zero at the end of the input, using
+// replacement selection over a heap of `capacity` rows. The least row
+// of the heap is written and replaced by the next input row, which
+// joins the current run if it does not sort before the row just written
+// and the next run otherwise. Runs average twice `capacity` rows on
+// random input and sorted input is a single run. Rows are passed in
+// order to `write(size_t run, const Frame&)` in batches of up to
+// `batch_rows`, the runs numbered from zero. Rows with equal keys keep
+// their input order within a run and are in earlier runs for earlier
+// input, so merging runs in order is stable. String fields of the input
+// must refer to a single heap, as with `RecordReader`, which the
+// written batches share. Returns the number of runs.
+template<class Read, class Write>
+size_t replacement_selection(size_t capacity, size_t bytes_per_row, const Keys& keys, Read&& read,
+			     Write&& write, size_t batch_rows = 4096) {
+    using namespace replacement_detail;
+    capacity = std::clamp<size_t>(capacity, 1, std::numeric_limits<RowIndex>::max());
+    batch_rows = std::max<size_t>(1, batch_rows);
+
+    Frame input(0, bytes_per_row, false);
+    size_t input_idx{};
+    bool exhausted{false};
+    auto next = [&](uint8_t *row) {
+	if (exhausted)
+	    return false;
+	if (input_idx == input.nrows()) {
+	    if (read(input, batch_rows) == 0) {
+		exhausted = true;
+		return false;
+	    }
+	    input_idx = 0;
+	}
+	std::memcpy(row, input.row(input_idx++), bytes_per_row);
+	return true;
+    };
+
+    Frame work(capacity, bytes_per_row, false);
+    size_t nwork{};
+    while (nwork < capacity and next(work.row(nwork)))
+	++nwork;
+    if (nwork == 0)
+	return 0;
+    work.share_heap(input);
+    auto bound = bind_heap(input, keys);
+
+    // Without String keys the rows are first compared by up to eight
+    // bytes of their normalized keys, which decides most comparisons.
+    RadixDigits digits;
+    bool string_keys = std::any_of(keys.begin(), keys.end(), [](const Key& key) {
+	return key.type == DataType::String;
+    });
+    if (not string_keys)
+	digits = radix_digits(keys);
+    const bool prefix_only = not string_keys and digits.size() <= sizeof(uint64_t);
+    digits.resize(std::min(digits.size(), sizeof(uint64_t)));
+    auto prefix = [&](const uint8_t *row) {
+	uint64_t value{};
+	for (const auto& digit : digits)
+	    value = (value << 8) | digit(row);
+	return value;
+    };
+    auto compare_keys = [&](const uint8_t *a, uint64_t a_prefix, const uint8_t *b, uint64_t b_prefix) {
+	if (a_prefix != b_prefix)
+	    return a_prefix < b_prefix ? -1 : 1;
+	return prefix_only ? 0 : compare_rows(a, bound, b, bound);
+    };
+
+    // Each row of the heap is tagged with its run, key prefix and
+    // input position, which orders rows of the same run with equal
+    // keys, in the heap entry itself so most comparisons do not touch
+    // the rows.
+    std::vector<Entry> heap(nwork);
+    for (size_t idx = 0; idx < nwork; ++idx)
+	heap[idx] = Entry{prefix(work.row(idx)), idx, RowIndex(idx), 0};
+    uint64_t nseq = nwork;
+    auto less = [&](const Entry& a, const Entry& b) {
+	if (a.run != b.run)
+	    return a.run < b.run;
+	if (auto cmp = compare_keys(work.row(a.slot), a.prefix, work.row(b.slot), b.prefix))
+	    return cmp < 0;
+	return a.seq < b.seq;
+    };
+    for (auto idx = heap.size() / 2; idx-- > 0;)
+	sift_down(heap, idx, less);
+
+    Frame batch(batch_rows, bytes_per_row, false);
+    batch.share_heap(input);
+    size_t nbatch{};
+    uint32_t run{};
+    auto flush = [&]() {
+	batch.resize(nbatch);
+	write(size_t{run}, std::as_const(batch));
+	batch.resize(batch_rows);
+	nbatch = 0;
+    };
+
+    while (not heap.empty()) {
+	auto& top = heap.front();
+	if (top.run != run) {
+	    if (nbatch > 0)
+		flush();
+	    run = top.run;
+	}
+	const auto *last = batch.row(nbatch);
+	auto last_prefix = top.prefix;
+	auto *row = work.row(top.slot);
+	std::memcpy(batch.row(nbatch), row, bytes_per_row);
+
+	if (next(row)) {
+	    top.seq = nseq++;
+	    top.prefix = prefix(row);
+	    top.run = run + (compare_keys(row, top.prefix, last, last_prefix) < 0);
+	} else {
+	    heap.front() = heap.back();
+	    heap.pop_back();
+	}
+	if (not heap.empty())
+	    sift_down(heap, 0, less);
+
+	if (++nbatch == batch_rows)
+	    flush();
+    }
+    if (nbatch > 0)
+	flush();
+    return size_t{run} + 1;
+}
+
+}; // core::sort
@@ -0,0 +1,100 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace core::sort {
+
+// Default distance in elements that the radix scatter loops prefetch
+// ahead of the element being scattered.
+inline constexpr size_t RadixPrefetchDistance = 16;
+
+// Software write-combining for a radix scatter into `dst`. Elements
+// pushed to a bucket are staged in a cache-line buffer for that bucket
+// and written to `dst` a whole line at a time, using non-temporal
+// stores when SSE2 is available, so a scatter to 256 random positions
+// becomes a sequence of full cache-line writes. The first and last
+// lines of a bucket are usually partial and are copied normally.
+// `flush` must be called before `dst` is read.
+template<class T>
+class WriteCombiner {
+public:
+    static constexpr size_t LineSize = 64;
+    static constexpr size_t LineEntries = LineSize / sizeof(T);
+
+    // Construct a combiner whose bucket `b` starts at `dst[offsets[b]]`.
+    template<class Offset>
+    WriteCombiner(T *dst, const Offset *offsets, size_t nbuckets)
+	: lines_(nbuckets)
+	, base_(nbuckets)
+	, start_(nbuckets)
+	, fill_(nbuckets) {
+	reset(dst, offsets);
+    }
+
+    // Start a new scatter into `dst` reusing the buffers. Any previous
+    // scatter must have been flushed.
+    template<class Offset>
+    void reset(T *dst, const Offset *offsets) {
+	for (size_t b = 0; b < lines_.size(); ++b) {
+	    auto *ptr = dst + offsets[b];
+	    auto skip = (reinterpret_cast<uintptr_t>(ptr) % LineSize) / sizeof(T);
+	    base_[b] = ptr - skip;
+	    start_[b] = fill_[b] = skip;
+	}
+    }
+
+    void push(size_t b, T value) {
+	auto& fill = fill_[b];
+	lines_[b].data[fill++] = value;
+	if (fill == LineEntries) {
+	    if (start_[b] == 0) store_line(base_[b], lines_[b].data);
+	    else std::memcpy(base_[b] + start_[b], lines_[b].data + start_[b],
+			     (LineEntries - start_[b]) * sizeof(T));
+	    base_[b] += LineEntries;
+	    start_[b] = fill = 0;
+	}
+    }
+
+    // Write the partially filled lines and order the non-temporal
+    // stores before any subsequent reads.
+    void flush() {
+	for (size_t b = 0; b < lines_.size(); ++b) {
+	    if (fill_[b] > start_[b])
+		std::memcpy(base_[b] + start_[b], lines_[b].data + start_[b],
+			    (fill_[b] - start_[b]) * sizeof(T));
+	    start_[b] = fill_[b];
+	}
+#ifdef __SSE2__
+	_mm_sfence();
+#endif
+    }
+
+private:
+    struct alignas(LineSize) Line {
+	T data[LineEntries];
+    };
+
+    static void store_line(T *dst, const T *src) {
+#ifdef __SSE2__
+	auto *d = reinterpret_cast<__m128i*>(dst);
+	auto *s = reinterpret_cast<const __m128i*>(src);
+	for (size_t i = 0; i < LineSize / sizeof(__m128i); ++i)
+	    _mm_stream_si128(d + i, _mm_load_si128(s + i));
+#else
+	std::memcpy(dst, src, LineSize);
+#endif
+    }
+
+    std::vector<Line> lines_;
+    std::vector<T*> base_;
+    std::vector<size_t> start_, fill_;
+};
+
+}; // core::sort
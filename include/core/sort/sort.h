@@ -0,0 +1,74 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include "frame.h"
+#include "key.h"
+#include "adaptive_sort.h"
+#include "quick_block_sort.h"
+#include "radix_sort_index.h"
+#include "sort_context.h"
+#include "stable_sort.h"
+
+namespace core::sort {
+
+struct SortOptions {
+    // If true, rows with equal keys keep their original relative order.
+    bool stable{false};
+    // If true, the input is expected to contain long sorted runs.
+    bool adaptive{false};
+    size_t threads{1};
+    // If set, scratch memory is taken from this context.
+    SortContext *context{nullptr};
+};
+
+namespace sort_detail {
+
+void merge_sort(Frame& frame, const Keys& keys, const SortOptions& options) {
+    if (options.context) stable_merge_sort(frame, keys, *options.context, options.threads);
+    else stable_merge_sort(frame, keys, options.threads);
+}
+
+}; // sort_detail
+
+// Sort `frame` by `keys` choosing an engine from `options`. Stable
+// sorts of wide rows sort an index and then move each row once; other
+// stable sorts use the parallel stable merge sort. Single-threaded
+// adaptive sorts merge the natural runs of the input. String keys are
+// bound to the side heap of `frame`.
+void sort(Frame& frame, const Keys& sort_keys, const SortOptions& options = {}) {
+    using sort_detail::merge_sort;
+    constexpr size_t WideRow = 32;
+    if (frame.nrows() < 2)
+	return;
+
+    auto keys = bind_heap(frame, sort_keys);
+
+    bool radix_keys = std::none_of(keys.begin(), keys.end(), [](const Key& key) {
+	return key.type == DataType::String;
+    });
+
+    if (options.adaptive and options.threads <= 1) {
+	adaptive_sort(frame, keys);
+    } else if (options.stable) {
+	if (radix_keys and frame.bytes_per_row() >= WideRow) {
+	    bool prefix = radix_digits(keys).size() <= sizeof(uint64_t);
+	    if (auto *context = options.context) {
+		if (prefix) order_by(frame, stable_prefix_index(frame, keys, *context), *context);
+		else order_by(frame, radix_index(frame, keys, *context), *context);
+	    } else {
+		if (prefix) frame = frame.order_by(stable_prefix_index(frame, keys));
+		else frame = frame.order_by(radix_index(frame, keys));
+	    }
+	} else {
+	    merge_sort(frame, keys, options);
+	}
+    } else if (options.threads > 1) {
+	merge_sort(frame, keys, options);
+    } else {
+	quick_block_sort(frame, keys);
+    }
+}
+
+}; // core::sort
@@ -0,0 +1,74 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <any>
+#include <deque>
+#include <optional>
+#include <vector>
+#include "allocator.h"
+#include "frame.h"
+
+namespace core::sort {
+
+// A vector of uninitialized, cache-line aligned scratch elements.
+template<class T>
+using ScratchVector = std::vector<T, AlignedAllocator<T>>;
+
+// Reusable scratch memory for the sort engines. Passing the same
+// context to repeated calls lets the engines reuse the buffers of the
+// previous call instead of allocating, and page faulting, new ones.
+// Engines use the numbered vector slots from zero so results returned
+// by reference into a context are valid until it is next used. A
+// context must not be used by more than one call at a time.
+class SortContext {
+public:
+    // Return the scratch vector in `slot` for elements of type `T`. The
+    // contents are left from the previous use but the capacity is kept
+    // so resizing does not allocate once the context is warm. A slot
+    // last used for a different type is replaced. References to other
+    // slots remain valid.
+    template<class T>
+    ScratchVector<T>& vector(size_t slot) {
+	if (slot >= vectors_.size())
+	    vectors_.resize(slot + 1);
+	auto *ptr = std::any_cast<ScratchVector<T>>(&vectors_[slot]);
+	if (not ptr)
+	    ptr = &vectors_[slot].emplace<ScratchVector<T>>();
+	return *ptr;
+    }
+
+    // Return a scratch frame with the shape of `frame` sharing its side
+    // heap. The rows are uninitialized.
+    Frame& frame_like(const Frame& frame) {
+	if (not frame_ or frame_->bytes_per_row() != frame.bytes_per_row()
+	    or frame_->policy() != frame.policy())
+	    frame_.emplace(frame.nrows(), frame.bytes_per_row(), false, frame.policy());
+	frame_->resize(frame.nrows());
+	frame_->share_heap(frame);
+	return *frame_;
+    }
+
+    // Release all scratch memory.
+    void clear() {
+	vectors_.clear();
+	frame_.reset();
+    }
+
+private:
+    std::deque<std::any> vectors_;
+    std::optional<Frame> frame_;
+};
+
+// Move the rows of `frame` into the order of `index` through the
+// scratch frame of `context`, which keeps the old rows for reuse.
+template<class Index>
+void order_by(Frame& frame, const Index& index, SortContext& context) {
+    auto& buffer = context.frame_like(frame);
+    for (size_t i = 0; i < index.size(); ++i)
+	std::copy(frame.row(index[i]), frame.row(index[i] + 1), buffer.row(i));
+    std::swap(frame, buffer);
+}
+
+}; // core::sort
@@ -0,0 +1,118 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <stdexcept>
+#include <vector>
+#include "adaptive_sort.h"
+#include "frame.h"
+#include "key.h"
+#include "merge_sort.h"
+
+namespace core::sort {
+
+// A frame kept sorted by `keys` under appends. Appended rows go to an
+// unsorted tail. When the tail reaches `tail_threshold` rows it is
+// sorted and pushed as a new level, and adjacent levels are merged
+// while the older level is less than twice the size of the newer one,
+// so there are O(log n) levels. Reads merge the tail and all levels
+// into a single sorted frame on demand. Rows with equal keys stay in
+// append order. String fields of every batch must refer to the same
+// side heap, which the levels share, and `append` throws otherwise.
+class SortedFrame {
+public:
+    SortedFrame(size_t bytes_per_row, Keys keys, size_t tail_threshold = 4096)
+	: keys_(std::move(keys))
+	, tail_threshold_(std::max<size_t>(1, tail_threshold))
+	, tail_(0, bytes_per_row, false) {
+    }
+
+    // Append the rows of `batch`.
+    void append(const Frame& batch) {
+	if (batch.heap() and batch.heap() != tail_.heap()) {
+	    if (tail_.heap())
+		throw std::runtime_error("SortedFrame::append: batches must share one side heap");
+	    tail_.share_heap(batch);
+	}
+	tail_.append(batch);
+	if (tail_.nrows() >= tail_threshold_)
+	    flush();
+    }
+
+    auto nrows() const {
+	size_t n = tail_.nrows();
+	for (const auto& level : levels_)
+	    n += level.nrows();
+	return n;
+    }
+
+    auto bytes_per_row() const {
+	return tail_.bytes_per_row();
+    }
+
+    const Keys& keys() const {
+	return keys_;
+    }
+
+    // Return the number of sorted levels, not counting the tail.
+    auto nlevels() const {
+	return levels_.size();
+    }
+
+    // Return the rows as a single sorted frame, merging any pending
+    // levels and tail first.
+    const Frame& frame() {
+	flush();
+	while (levels_.size() > 1)
+	    merge_top();
+	if (levels_.empty())
+	    levels_.push_back(empty_like(tail_));
+	return levels_.front();
+    }
+
+    const ElementType *row(size_t idx) {
+	return frame().row(idx);
+    }
+
+    const ElementType *begin() {
+	return frame().begin();
+    }
+
+    const ElementType *end() {
+	return frame().end();
+    }
+
+private:
+    // Sort the tail into a new level and restore the level invariant.
+    void flush() {
+	if (tail_.nrows() == 0)
+	    return;
+	adaptive_sort(tail_, keys_);
+	levels_.push_back(std::move(tail_));
+	tail_ = empty_like(levels_.back());
+	while (levels_.size() > 1 and levels_[levels_.size() - 2].nrows() < 2 * levels_.back().nrows())
+	    merge_top();
+    }
+
+    // Return a frame with no rows and no storage shaped like `frame`,
+    // with its page policy and sharing its side heap.
+    static Frame empty_like(const Frame& frame) {
+	Frame empty(0, frame.bytes_per_row(), false, frame.policy());
+	empty.share_heap(frame);
+	return empty;
+    }
+
+    // Merge the two newest levels.
+    void merge_top() {
+	auto newer = std::move(levels_.back());
+	levels_.pop_back();
+	levels_.back() = merge(levels_.back(), newer, keys_);
+    }
+
+    Keys keys_;
+    size_t tail_threshold_;
+    Frame tail_;
+    std::vector<Frame> levels_;
+};
+
+}; // core::sort
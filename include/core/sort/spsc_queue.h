@@ -0,0 +1,55 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <atomic>
+#include "array_ring.h"
+
+namespace core::sort {
+
+// A bounded lock-free queue of up to `Size` elements between one
+// producer thread and one consumer thread, using the storage and
+// indices of an `ArrayRing`. The producer is the only writer of the
+// head index and the consumer the only writer of the tail index. Each
+// publishes its index with a release store that the other side reads
+// with an acquire load, so an element is fully written before it can
+// be popped and fully read before its slot can be reused. Each side
+// caches the last index it read from the other, on its own cache line,
+// and rereads it only when the queue looks full or empty.
+template<class T, size_t Size>
+class SpscQueue {
+public:
+    // Push `value` unless the queue is full. Producer only.
+    bool try_push(const T& value) {
+	auto head = ring_.head_index();
+	if (head - cached_tail_ == Size) {
+	    cached_tail_ = std::atomic_ref(ring_.tail_index()).load(std::memory_order_acquire);
+	    if (head - cached_tail_ == Size)
+		return false;
+	}
+	ring_.next() = value;
+	std::atomic_ref(ring_.head_index()).store(head + 1, std::memory_order_release);
+	return true;
+    }
+
+    // Pop the oldest element into `value` unless the queue is
+    // empty. Consumer only.
+    bool try_pop(T& value) {
+	auto tail = ring_.tail_index();
+	if (cached_head_ == tail) {
+	    cached_head_ = std::atomic_ref(ring_.head_index()).load(std::memory_order_acquire);
+	    if (cached_head_ == tail)
+		return false;
+	}
+	value = ring_.front();
+	std::atomic_ref(ring_.tail_index()).store(tail + 1, std::memory_order_release);
+	return true;
+    }
+
+private:
+    ArrayRing<T, Size, 64> ring_;
+    alignas(64) size_t cached_tail_{};
+    alignas(64) size_t cached_head_{};
+};
+
+}; // core::sort
@@ -0,0 +1,165 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <numeric>
+#include "frame.h"
+#include "key.h"
+#include "insertion_sort.h"
+#include "parallel.h"
+#include "sort_context.h"
+
+namespace core::sort {
+
+namespace stable_detail {
+
+// Return the number of rows taken from the left run [lbegin, lbegin +
+// llen) among the first `k` rows of the stable merge with the right
+// run [rbegin, rbegin + rlen). Equal rows are taken from the left.
+size_t merge_path(const Frame& frame, const Keys& keys,
+		  size_t lbegin, size_t llen, size_t rbegin, size_t rlen, size_t k) {
+    size_t lo = k > rlen ? k - rlen : 0, hi = std::min(k, llen);
+    while (lo < hi) {
+	auto i = lo + (hi - lo) / 2, j = k - i;
+	if (not compare(frame.row(rbegin + j - 1), frame.row(lbegin + i), keys)) lo = i + 1;
+	else hi = i;
+    }
+    return lo;
+}
+
+// Merge the rows [ldx, ledx) and [rdx, redx) of `src` into `dst`
+// starting at row `odx`. Equal rows are taken from the left.
+void merge_rows(const Frame& src, Frame& dst, const Keys& keys,
+		size_t ldx, size_t ledx, size_t rdx, size_t redx, size_t odx) {
+    const auto bpr = src.bytes_per_row();
+    auto out = dst.row(odx);
+    while (ldx < ledx and rdx < redx) {
+	auto lptr = src.row(ldx), rptr = src.row(rdx);
+	if (not compare(rptr, lptr, keys)) {
+	    std::copy(lptr, lptr + bpr, out);
+	    ++ldx;
+	} else {
+	    std::copy(rptr, rptr + bpr, out);
+	    ++rdx;
+	}
+	out += bpr;
+    }
+    out = std::copy(src.row(ldx), src.row(ledx), out);
+    std::copy(src.row(rdx), src.row(redx), out);
+}
+
+}; // stable_detail
+
+// Stable parallel merge sort. Blocks of `BlockSize` rows are insertion
+// sorted and then merged bottom-up using `buffer`, which has the shape
+// of `frame`, as scratch. Each level is merged by `nth` threads which
+// split the output rows evenly using merge-path.
+void stable_merge_sort(Frame& frame, const Keys& sort_keys, Frame& buffer, size_t nth) {
+    constexpr size_t BlockSize = 16;
+    const auto n = frame.nrows();
+    if (n < 2)
+	return;
+
+    auto keys = bind_heap(frame, sort_keys);
+
+    parallel_for(nth, n, [&](size_t, size_t begin, size_t end) {
+	for (auto bdx = begin; bdx < end; bdx += BlockSize)
+	    insertion_sort(frame, keys, bdx, std::min(bdx + BlockSize, end));
+    }, BlockSize);
+
+    Frame *src = &frame, *dst = &buffer;
+    for (size_t w = BlockSize; w < n; w *= 2) {
+	parallel_for(nth, n, [&](size_t, size_t begin, size_t end) {
+	    for (auto pdx = begin / (2 * w) * (2 * w); pdx < end; pdx += 2 * w) {
+		auto ldx = pdx, rdx = std::min(pdx + w, n), redx = std::min(pdx + 2 * w, n);
+		auto obegin = std::max(begin, pdx) - pdx, oend = std::min(end, redx) - pdx;
+		auto lbegin = stable_detail::merge_path(*src, keys, ldx, rdx - ldx, rdx, redx - rdx, obegin);
+		auto lend = stable_detail::merge_path(*src, keys, ldx, rdx - ldx, rdx, redx - rdx, oend);
+		stable_detail::merge_rows(*src, *dst, keys,
+					  ldx + lbegin, ldx + lend,
+					  rdx + obegin - lbegin, rdx + oend - lend,
+					  pdx + obegin);
+	    }
+	});
+	std::swap(src, dst);
+    }
+
+    if (src != &frame)
+	std::swap(frame, buffer);
+}
+
+void stable_merge_sort(Frame& frame, const Keys& keys, size_t nth = 1) {
+    Frame buffer = frame.empty_clone();
+    stable_merge_sort(frame, keys, buffer, nth);
+}
+
+void stable_merge_sort(Frame& frame, const Keys& keys, SortContext& context, size_t nth = 1) {
+    stable_merge_sort(frame, keys, context.frame_like(frame), nth);
+}
+
+namespace stable_detail {
+
+template<class Index>
+struct PrefixEntry {
+    uint64_t prefix;
+    Index row;
+};
+
+template<class Index, class Entries, class IndexVector>
+void stable_prefix_index(const Frame& frame, const Keys& keys, Entries& entries, IndexVector& index) {
+    using Entry = PrefixEntry<Index>;
+    auto digits = radix_digits(keys);
+    const auto exact = digits.size() <= sizeof(uint64_t);
+    digits.resize(std::min(digits.size(), sizeof(uint64_t)));
+
+    entries.resize(frame.nrows());
+    for (size_t i = 0; i < frame.nrows(); ++i) {
+	auto row = frame.row(i);
+	uint64_t prefix{};
+	for (const auto& digit : digits)
+	    prefix = (prefix << 8) | digit(row);
+	prefix <<= 8 * (sizeof(uint64_t) - digits.size());
+	entries[i] = {prefix, Index(i)};
+    }
+
+    std::sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b) {
+	if (a.prefix != b.prefix)
+	    return a.prefix < b.prefix;
+	if (not exact) {
+	    auto aptr = frame.row(a.row), bptr = frame.row(b.row);
+	    if (compare(aptr, bptr, keys)) return true;
+	    if (compare(bptr, aptr, keys)) return false;
+	}
+	return a.row < b.row;
+    });
+
+    index.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+	index[i] = entries[i].row;
+}
+
+}; // stable_detail
+
+// Return the stable sort index for `frame` by sorting pairs of the
+// first eight normalized key bytes and the row id. Rows with equal
+// prefixes are ordered by the remaining key bytes and then row id.
+template<class Index = RowIndex>
+auto stable_prefix_index(const Frame& frame, const Keys& keys) {
+    std::vector<stable_detail::PrefixEntry<Index>> entries;
+    std::vector<Index> index;
+    stable_detail::stable_prefix_index<Index>(frame, keys, entries, index);
+    return index;
+}
+
+// As above, but all memory comes from `context`. The returned index
+// is valid until `context` is next used.
+template<class Index = RowIndex>
+const auto& stable_prefix_index(const Frame& frame, const Keys& keys, SortContext& context) {
+    auto& index = context.vector<Index>(1);
+    stable_detail::stable_prefix_index<Index>(frame, keys, context.vector<stable_detail::PrefixEntry<Index>>(0),
+					      index);
+    return index;
+}
+
+}; // core::sort
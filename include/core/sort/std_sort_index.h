@@ -8,20 +8,21 @@
 
 namespace core::sort {
 
-template<class Compare>
+template<class Index = RowIndex, class Compare>
 auto std_sort_index(size_t n, Compare compare) {
-    std::vector<int> index(n);
-    for (auto i = 0; i < index.size(); ++i)
+    std::vector<Index> index(n);
+    for (size_t i = 0; i < index.size(); ++i)
 	index[i] = i;
 
     std::sort(index.begin(), index.end(), compare);
     return index;
 }
 
-auto std_sort_index(Frame& frame, const Keys& sort_keys) {
-    auto ptr = reinterpret_cast<uint8_t*>(frame.begin());
+template<class Index = RowIndex>
+auto std_sort_index(const Frame& frame, const Keys& sort_keys) {
+    auto ptr = reinterpret_cast<const uint8_t*>(frame.begin());
     auto l = frame.bytes_per_row();
-    return std_sort_index(frame.nrows(), [&](int idx, int jdx) {
+    return std_sort_index<Index>(frame.nrows(), [&](Index idx, Index jdx) {
 	return compare(ptr + idx * l, ptr + jdx * l, sort_keys);
     });
 }
@@ -0,0 +1,240 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include "frame.h"
+#include "key.h"
+
+namespace core::sort {
+
+// Engines for sorting on a leading FixedString or String key. Each
+// returns an index (like `radix_index`) ordered by the string value
+// of `keys[0]`, honoring its order and NULL ordering, with ties broken
+// by the remaining keys.
+
+namespace string_sort_detail {
+
+inline constexpr size_t InsertionThreshold = 16;
+inline constexpr size_t RadixThreshold = 64;
+
+struct StringEntry {
+    const uint8_t *data;
+    uint32_t length;
+    RowIndex row;
+};
+
+// The direction of the leading key and the comparison of the
+// remaining keys used to break ties.
+struct Context {
+    const Frame& frame;
+    Keys rest;
+    bool desc;
+
+    // The character of `entry` at `depth` as a digit in [0, 256]
+    // ordered in the direction of the key: 1 + c ascending and 255 - c
+    // descending. The end of the string orders before (ascending, 0)
+    // or after (descending, 256) any character, including NUL.
+    int digit(const StringEntry& entry, size_t depth) const {
+	if (depth < entry.length)
+	    return desc ? 255 - entry.data[depth] : 1 + entry.data[depth];
+	return end_digit();
+    }
+
+    int end_digit() const {
+	return desc ? 256 : 0;
+    }
+
+    bool tiebreak(const StringEntry& a, const StringEntry& b) const {
+	return compare(frame.row(a.row), frame.row(b.row), rest);
+    }
+
+    // Compare two entries whose strings are known to agree before
+    // byte `depth`.
+    bool less(const StringEntry& a, const StringEntry& b, size_t depth) const {
+	auto n = std::min(a.length, b.length);
+	if (depth < n) {
+	    auto r = std::memcmp(a.data + depth, b.data + depth, n - depth);
+	    if (r != 0)
+		return desc ? r > 0 : r < 0;
+	}
+	if (a.length != b.length)
+	    return desc ? a.length > b.length : a.length < b.length;
+	return tiebreak(a, b);
+    }
+};
+
+void insertion_sort(StringEntry *entries, size_t n, size_t depth, const Context& ctx) {
+    for (size_t i = 1; i < n; ++i) {
+	auto tmp = entries[i];
+	auto j = i;
+	for (; j > 0 and ctx.less(tmp, entries[j - 1], depth); --j)
+	    entries[j] = entries[j - 1];
+	entries[j] = tmp;
+    }
+}
+
+// Sort entries whose strings are all equal using the remaining keys.
+void sort_equal(StringEntry *entries, size_t n, const Context& ctx) {
+    if (n > 1 and not ctx.rest.empty())
+	std::sort(entries, entries + n, [&](const auto& a, const auto& b) {
+	    return ctx.tiebreak(a, b);
+	});
+}
+
+// Bentley-Sedgewick multikey (three-way radix) quicksort.
+void multikey_quick_sort(StringEntry *entries, size_t n, size_t depth, const Context& ctx) {
+    while (n > 1) {
+	if (n < InsertionThreshold) {
+	    insertion_sort(entries, n, depth, ctx);
+	    return;
+	}
+
+	auto a = ctx.digit(entries[0], depth);
+	auto b = ctx.digit(entries[n / 2], depth);
+	auto c = ctx.digit(entries[n - 1], depth);
+	auto pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+	size_t lt = 0, i = 0, gt = n;
+	while (i < gt) {
+	    auto ch = ctx.digit(entries[i], depth);
+	    if (ch < pivot) std::swap(entries[lt++], entries[i++]);
+	    else if (ch > pivot) std::swap(entries[i], entries[--gt]);
+	    else ++i;
+	}
+
+	multikey_quick_sort(entries, lt, depth, ctx);
+	multikey_quick_sort(entries + gt, n - gt, depth, ctx);
+
+	if (pivot == ctx.end_digit()) {
+	    sort_equal(entries + lt, gt - lt, ctx);
+	    return;
+	}
+	entries += lt;
+	n = gt - lt;
+	++depth;
+    }
+}
+
+// MSD radix sort on one byte per level, falling back to multikey
+// quicksort for small buckets.
+void msd_radix_sort(StringEntry *entries, StringEntry *buffer, size_t n, size_t depth,
+		    const Context& ctx) {
+    if (n < RadixThreshold) {
+	multikey_quick_sort(entries, n, depth, ctx);
+	return;
+    }
+
+    std::array<size_t, 258> counts{};
+    for (size_t i = 0; i < n; ++i)
+	++counts[1 + ctx.digit(entries[i], depth)];
+    for (size_t i = 1; i < counts.size(); ++i)
+	counts[i] += counts[i - 1];
+
+    for (size_t i = 0; i < n; ++i)
+	buffer[counts[ctx.digit(entries[i], depth)]++] = entries[i];
+    std::copy(buffer, buffer + n, entries);
+
+    for (int b = 0; b < 257; ++b) {
+	auto begin = b == 0 ? 0 : counts[b - 1], end = counts[b];
+	if (end - begin < 2)
+	    continue;
+	if (b == ctx.end_digit()) sort_equal(entries + begin, end - begin, ctx);
+	else msd_radix_sort(entries + begin, buffer + begin, end - begin, depth + 1, ctx);
+    }
+}
+
+Key leading_string_key(const Keys& keys) {
+    if (keys.empty() or (keys[0].type != DataType::FixedString
+			 and keys[0].type != DataType::String))
+	throw std::runtime_error("string sort: the first key must be a FixedString or String");
+    return keys[0];
+}
+
+// Sort the rows of `frame` by `sort_keys` using `engine` to sort the
+// entries with non-NULL leading strings. The entries with NULL leading
+// strings are ordered by the remaining keys and placed first or last.
+template<class Engine>
+auto string_sort_index(const Frame& frame, const Keys& sort_keys, Engine&& engine) {
+    auto keys = bind_heap(frame, sort_keys);
+    auto key = leading_string_key(keys);
+    Context ctx{frame, Keys(keys.begin() + 1, keys.end()), key.descending()};
+
+    std::vector<StringEntry> entries, nulls;
+    entries.reserve(frame.nrows());
+    for (size_t i = 0; i < frame.nrows(); ++i) {
+	if (key.is_null(frame.row(i))) {
+	    nulls.push_back({nullptr, 0, RowIndex(i)});
+	} else {
+	    auto str = string_value(frame.row(i), key);
+	    entries.push_back({reinterpret_cast<const uint8_t*>(str.data()),
+			       uint32_t(str.size()), RowIndex(i)});
+	}
+    }
+
+    engine(entries, ctx);
+    sort_equal(nulls.data(), nulls.size(), ctx);
+
+    std::vector<RowIndex> index;
+    index.reserve(frame.nrows());
+    if (key.nulls == NullOrder::First)
+	for (const auto& entry : nulls)
+	    index.push_back(entry.row);
+    for (const auto& entry : entries)
+	index.push_back(entry.row);
+    if (key.nulls == NullOrder::Last)
+	for (const auto& entry : nulls)
+	    index.push_back(entry.row);
+    return index;
+}
+
+}; // string_sort_detail
+
+auto multikey_quick_sort_index(const Frame& frame, const Keys& sort_keys) {
+    using namespace string_sort_detail;
+    return string_sort_index(frame, sort_keys, [](auto& entries, const Context& ctx) {
+	multikey_quick_sort(entries.data(), entries.size(), 0, ctx);
+    });
+}
+
+auto string_radix_index(const Frame& frame, const Keys& sort_keys) {
+    using namespace string_sort_detail;
+    return string_sort_index(frame, sort_keys, [](auto& entries, const Context& ctx) {
+	std::vector<StringEntry> buffer(entries.size());
+	msd_radix_sort(entries.data(), buffer.data(), entries.size(), 0, ctx);
+    });
+}
+
+// Sort on the first eight bytes of the string, cached in big-endian
+// order alongside the entry, and compare the full strings only when
+// the prefixes tie.
+auto string_prefix_index(const Frame& frame, const Keys& sort_keys) {
+    using namespace string_sort_detail;
+    return string_sort_index(frame, sort_keys, [](auto& entries, const Context& ctx) {
+	struct PrefixEntry {
+	    uint64_t prefix;
+	    StringEntry entry;
+	};
+
+	std::vector<PrefixEntry> prefixed(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+	    const auto& entry = entries[i];
+	    uint64_t prefix{};
+	    for (size_t j = 0; j < sizeof(prefix); ++j)
+		prefix = (prefix << 8) | (j < entry.length ? entry.data[j] : 0);
+	    prefixed[i] = {ctx.desc ? ~prefix : prefix, entry};
+	}
+
+	std::sort(prefixed.begin(), prefixed.end(), [&](const auto& a, const auto& b) {
+	    if (a.prefix != b.prefix)
+		return a.prefix < b.prefix;
+	    return ctx.less(a.entry, b.entry, sizeof(uint64_t));
+	});
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	    entries[i] = prefixed[i].entry;
+    });
+}
+
+}; // core::sort
@@ -0,0 +1,167 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace core::sort {
+
+// The cpus of one NUMA node, or of one socket when the node layout is
+// not available.
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// The NUMA nodes of the machine that have at least one usable cpu.
+struct Topology {
+    std::vector<NumaNode> nodes;
+
+    size_t ncpus() const {
+	size_t n{};
+	for (const auto& node : nodes)
+	    n += node.cpus.size();
+	return n;
+    }
+
+    // Read the layout from sysfs under `root`. The cpus of each node
+    // come from node/node*/cpulist. Without node directories the cpus
+    // are grouped by cpu/cpu*/topology/physical_package_id, and without
+    // either all cpus form a single node. If `allowed` is non-empty
+    // only those cpus are kept.
+    static Topology read(const std::filesystem::path& root = "/sys/devices/system",
+			 const std::vector<int>& allowed = {});
+
+    // Return the layout of this machine restricted to the cpus this
+    // process may run on. It is read once.
+    static const Topology& system();
+};
+
+// Parse a sysfs cpu list such as "0-3,8,10-11".
+std::vector<int> parse_cpu_list(std::string_view str) {
+    std::vector<int> cpus;
+    while (not str.empty() and str.back() == '\n')
+	str.remove_suffix(1);
+    while (not str.empty()) {
+	auto comma = str.find(',');
+	auto item = str.substr(0, comma);
+	str = comma == std::string_view::npos ? std::string_view{} : str.substr(comma + 1);
+
+	auto dash = item.find('-');
+	try {
+	    auto first = std::stoi(std::string(item.substr(0, dash)));
+	    auto last = dash == std::string_view::npos ? first : std::stoi(std::string(item.substr(dash + 1)));
+	    for (auto cpu = first; cpu <= last; ++cpu)
+		cpus.push_back(cpu);
+	} catch (const std::logic_error&) {
+	    throw std::runtime_error(fmt::format("parse_cpu_list: bad cpu list item: '{}'", item));
+	}
+    }
+    return cpus;
+}
+
+namespace topology_detail {
+
+std::string read_line(const std::filesystem::path& path) {
+    std::ifstream ifs(path);
+    std::string line;
+    std::getline(ifs, line);
+    return line;
+}
+
+// Return the numeric suffix of `name` after `prefix`, or -1.
+int numbered(const std::string& name, std::string_view prefix) {
+    if (not name.starts_with(prefix) or name.size() == prefix.size())
+	return -1;
+    auto suffix = std::string_view(name).substr(prefix.size());
+    if (not std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' and c <= '9'; }))
+	return -1;
+    return std::stoi(std::string(suffix));
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	    if (CPU_ISSET(cpu, &set))
+		cpus.push_back(cpu);
+#endif
+    return cpus;
+}
+
+}; // topology_detail
+
+Topology Topology::read(const std::filesystem::path& root, const std::vector<int>& allowed) {
+    namespace fs = std::filesystem;
+    using namespace topology_detail;
+    std::error_code ec;
+    std::map<int, std::vector<int>> groups;
+
+    for (const auto& entry : fs::directory_iterator(root / "node", ec))
+	if (auto id = numbered(entry.path().filename().string(), "node"); id >= 0)
+	    groups[id] = parse_cpu_list(read_line(entry.path() / "cpulist"));
+
+    if (groups.empty()) {
+	for (const auto& entry : fs::directory_iterator(root / "cpu", ec)) {
+	    auto cpu = numbered(entry.path().filename().string(), "cpu");
+	    if (cpu < 0)
+		continue;
+	    auto package = read_line(entry.path() / "topology" / "physical_package_id");
+	    groups[package.empty() ? 0 : std::stoi(package)].push_back(cpu);
+	}
+    }
+
+    if (groups.empty()) {
+	auto& cpus = groups[0];
+	for (int cpu = 0; cpu < int(std::max(1u, std::thread::hardware_concurrency())); ++cpu)
+	    cpus.push_back(cpu);
+    }
+
+    Topology topology;
+    for (auto& [id, cpus] : groups) {
+	std::sort(cpus.begin(), cpus.end());
+	if (not allowed.empty())
+	    std::erase_if(cpus, [&](int cpu) { return not std::binary_search(allowed.begin(), allowed.end(), cpu); });
+	if (not cpus.empty())
+	    topology.nodes.push_back({id, std::move(cpus)});
+    }
+    if (topology.nodes.empty())
+	topology.nodes.push_back({0, allowed.empty() ? std::vector<int>{0} : allowed});
+    return topology;
+}
+
+const Topology& Topology::system() {
+    static const Topology topology = read("/sys/devices/system", topology_detail::allowed_cpus());
+    return topology;
+}
+
+// Restrict the calling thread to `cpus`. Returns false if the affinity
+// could not be set, in which case the thread is left unpinned.
+bool pin_current_thread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus)
+	if (cpu >= 0 and cpu < CPU_SETSIZE)
+	    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+}; // core::sort
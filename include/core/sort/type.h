@@ -2,11 +2,49 @@
 //
 
 #pragma once
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <fmt/format.h>
 #include "core/string/lexical_cast.h"
 
 namespace core::sort {
 
-enum class DataType { Signed64, Unsigned8, Unsigned16, Unsigned32, Unsigned64 };
+// FixedString is a fixed-width byte array compared lexicographically.
+// String is a `StringRef` referring to a byte array in a side heap.
+enum class DataType {
+    Signed8, Signed16, Signed32, Signed64, Signed128,
+    Unsigned8, Unsigned16, Unsigned32, Unsigned64, Unsigned128,
+    FixedString, String
+};
+
+struct StringRef {
+    uint32_t offset, length;
+};
+
+// Return the reference to `length` bytes at `offset` of a side heap.
+// Throws if either does not fit in 32 bits.
+StringRef make_string_ref(size_t offset, size_t length) {
+    constexpr size_t Max = std::numeric_limits<uint32_t>::max();
+    if (offset > Max or length > Max)
+	throw std::runtime_error(fmt::format("StringRef: string of {} bytes at heap offset {} "
+					     "exceeds 32 bits", length, offset));
+    return {uint32_t(offset), uint32_t(length)};
+}
+
+bool is_signed(DataType type) {
+    switch (type) {
+	using enum DataType;
+    case Signed8:
+    case Signed16:
+    case Signed32:
+    case Signed64:
+    case Signed128:
+	return true;
+    default:
+	return false;
+    }
+}
 
 }; // core::sort
 
@@ -16,11 +54,18 @@ template<>
 struct lexical_cast_impl<DataType> {
     static DataType parse(std::string_view s) {
 	using enum core::sort::DataType;
-	if (s == "i64") return Signed64;
+	if (s == "i8") return Signed8;
+	else if (s == "i16") return Signed16;
+	else if (s == "i32") return Signed32;
+	else if (s == "i64") return Signed64;
+	else if (s == "i128") return Signed128;
 	else if (s == "u8") return Unsigned8;
 	else if (s == "u16") return Unsigned16;
 	else if (s == "u32") return Unsigned32;
 	else if (s == "u64") return Unsigned64;
+	else if (s == "u128") return Unsigned128;
+	else if (s == "c") return FixedString;
+	else if (s == "str") return String;
 	throw lexical_cast_error(s, "DataType");
     }
 };
@@ -31,9 +76,21 @@ namespace core::sort {
 std::ostream& operator<<(std::ostream& os, DataType type) {
     switch (type) {
 	using enum DataType;
+    case Signed8:
+	os << "i8";
+	break;
+    case Signed16:
+	os << "i16";
+	break;
+    case Signed32:
+	os << "i32";
+	break;
     case Signed64:
 	os << "i64";
 	break;
+    case Signed128:
+	os << "i128";
+	break;
     case Unsigned8:
 	os << "u8";
 	break;
@@ -46,6 +103,15 @@ std::ostream& operator<<(std::ostream& os, DataType type) {
     case Unsigned64:
 	os << "u64";
 	break;
+    case Unsigned128:
+	os << "u128";
+	break;
+    case FixedString:
+	os << "c";
+	break;
+    case String:
+	os << "str";
+	break;
     }
     return os;
 }
@@ -0,0 +1,89 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <iostream>
+#include <fmt/format.h>
+#include "core/argparse/argp.h"
+#include "core/sort/external_sort.h"
+#include "core/sort/parallel.h"
+#include "core/sort/record_file.h"
+#include "core/timer/timer.h"
+
+using std::cout, std::cerr, std::endl;
+using core::argp::ArgParse, core::argp::argFlag, core::argp::argValue;
+using namespace core::sort;
+
+// Return the keys for the comma separated `specs`. Each spec is a
+// column name of `schema` with optional key options, as in
+// "score:desc", or a raw key such as "u64:8".
+Keys parse_keys(const Schema& schema, std::string_view specs) {
+    Keys keys;
+    for (auto spec : core::str::split(specs, ",")) {
+	auto name = spec.substr(0, spec.find(':'));
+	bool named = std::any_of(schema.columns.begin(), schema.columns.end(),
+				 [&](const Column& column) { return column.name == name; });
+	keys.push_back(named ? schema.key(spec) : core::str::lexical_cast<Key>(spec));
+    }
+    return keys;
+}
+
+int main(int argc, const char *argv[]) {
+    ArgParse opts
+	(
+	 argValue<'i'>("input", std::string{}, "Input record file"),
+	 argValue<'o'>("output", std::string{}, "Output record file, by default the input"),
+	 argValue<'k'>("keys", std::string{}, "Comma separated keys, e.g. name:desc,u64:8"),
+	 argValue<'t'>("threads", (uint64_t)default_concurrency(), "Number of threads"),
+	 argValue<'m'>("memory", (uint64_t)1024, "Memory limit in MiB"),
+	 argValue<'d'>("spill-dir", std::string{}, "Directory for spilled runs"),
+	 argFlag<'s'>("stable", "Keep the input order of rows with equal keys"),
+	 argFlag<'D'>("direct", "Use direct I/O"),
+	 argFlag<'c'>("compress", "Pack spilled runs"),
+	 argFlag<'r'>("replacement", "Generate runs by replacement selection"),
+	 argFlag<'v'>("verbose", "Verbose diagnostics")
+	 );
+    opts.parse(argc, argv);
+    auto input = opts.get<'i'>();
+    auto output = opts.get<'o'>().empty() ? input : opts.get<'o'>();
+    auto verbose = opts.get<'v'>();
+
+    try {
+	if (input.empty())
+	    throw std::runtime_error("An input record file must be specified");
+
+	ExternalSortOptions options;
+	options.stable = opts.get<'s'>();
+	options.threads = opts.get<'t'>();
+	options.memory_limit = opts.get<'m'>() << 20;
+	options.spill_dir = opts.get<'d'>();
+	options.io = opts.get<'D'>() ? RecordIo::Direct : RecordIo::Buffered;
+	options.compression = opts.get<'c'>() ? RecordCompression::Packed : RecordCompression::None;
+	options.runs = opts.get<'r'>() ? RunGeneration::Replacement : RunGeneration::Chunks;
+
+	Keys keys = parse_keys(RecordReader(input).schema(), opts.get<'k'>());
+	if (keys.empty())
+	    throw std::runtime_error("At least one sort key must be specified");
+	if (verbose)
+	    cout << fmt::format("sorting {} into {}", input, output) << endl;
+
+	core::timer::Timer timer;
+	timer.start();
+	auto stats = external_sort(input, output, keys, options);
+	timer.stop();
+
+	auto seconds = 1e-9 * timer.elapsed().count();
+	cout << fmt::format("{} rows, {:.1f} MiB, {} runs, {} merge passes, {:.3f} s, {:.1f} MiB/s",
+			    stats.nrows, stats.nbytes / 1048576.0, stats.nruns, stats.npasses,
+			    seconds, seconds > 0 ? stats.nbytes / 1048576.0 / seconds : 0.0)
+	     << endl;
+	if (verbose and stats.nruns > 0)
+	    cout << fmt::format("{:.1f} MiB spilled, {:.2f}x smaller than the rows",
+				stats.spill_bytes / 1048576.0,
+				stats.spill_bytes > 0 ? double(stats.nbytes) / stats.spill_bytes : 0.0)
+		 << endl;
+    } catch (const std::exception& error) {
+	cerr << "record_sort: " << error.what() << endl;
+	return 1;
+    }
+    return 0;
+}
@@ -1,13 +1,17 @@
 // Copyright (C) 2022, 2023 by Mark Melton
 //
+#include <iostream>
 #include <random>
 #include <span>
 #include <stdlib.h>
-#include "core/util/tool.h"
+#include <fmt/format.h>
+#include "core/argparse/argp.h"
 #include "core/sort/bitonic.h"
 #include "core/sort/is_sorted.h"
 #include "core/sort/fixed_sort.h"
+#include "core/sort/generate.h"
 #include "core/sort/merge_sort.h"
+#include "core/sort/packed_sort.h"
 #include "core/sort/quick_block_sort.h"
 #include "core/sort/quick_sort.h"
 #include "core/sort/radix_sort_index.h"
@@ -21,6 +25,9 @@
 #define MACOSX 1
 #endif
 
+using std::cout, std::cerr, std::endl;
+using core::argp::ArgParse, core::argp::argFlag, core::argp::argValue, core::argp::argValues;
+
 namespace core::sort {
 
 template<class Units, class Work, class Check>
@@ -28,7 +35,7 @@ size_t measure_sort_indirect(std::string_view desc, Work&& work, Check&& check)
     return timer::Timer().run(1, [&] {
 	auto result = work();
 	if (not check(result))
-	    throw core::runtime_error("{} failed correctness check", desc);
+	    throw std::runtime_error(fmt::format("{} failed correctness check", desc));
     }).elapsed().count();
 }
 
@@ -44,7 +51,7 @@ size_t measure_sort(std::string_view desc, Work&& work, Check&& check) {
     return timer::Timer().run(1, [&] {
 	work();
 	if (not check())
-	    throw core::runtime_error("{} failed correctness check", desc);
+	    throw std::runtime_error(fmt::format("{} failed correctness check", desc));
     }).elapsed().count();
 }
 
@@ -67,20 +74,28 @@ int tool_main(int argc, const char *argv[]) {
 	(
 	 argValue<'n'>("number-rows", (uint64_t)100, "Number of rows"),
 	 argValue<'r'>("bytes-per-row", (uint64_t)64, "Bytes per row"),
+	 argValue<'d'>("distribution", Distribution::Uniform,
+		       "Key distribution: uniform, zipf, duplicates or runs"),
+	 argValue<'s'>("seed", (uint64_t)0, "Random seed"),
 	 argValues<'*', std::vector, Key>("keys", "Sort keys"),
+	 argFlag<'H'>("huge-pages", "Allocate frames on transparent huge pages"),
 	 argFlag<'v'>("verbose", "Verbose diagnostics")
 	 );
     opts.parse(argc, argv);
     auto number_rows = opts.get<'n'>();
     auto bytes_per_row = opts.get<'r'>();
+    auto distribution = opts.get<'d'>();
+    auto seed = opts.get<'s'>();
     auto sort_keys = opts.get<'*'>();
+    auto huge_pages = opts.get<'H'>();
     auto verbose = opts.get<'v'>();
 
     if (bytes_per_row bitand 0x7)
-	throw core::runtime_error("bytes-per-row must be a multple of 8: {}", bytes_per_row);
+	throw std::runtime_error(fmt::format("bytes-per-row must be a multple of 8: {}",
+					     bytes_per_row));
 
     if (sort_keys.size() == 0)
-	throw core::runtime_error("At least one sort key must be specified");
+	throw std::runtime_error("At least one sort key must be specified");
 
     if (verbose)
 	cout << fmt::format("creating random dataset with {} rows and {} bytes-per-row",
@@ -95,7 +110,11 @@ int tool_main(int argc, const char *argv[]) {
     
     core::timer::Timer<std::chrono::milliseconds> timer;
     timer.start();
-    Frame frame{number_rows, bytes_per_row};
+    ColumnGenerators columns;
+    for (const auto& key : sort_keys)
+	columns.push_back({key, distribution});
+    auto frame = generate_frame(number_rows, bytes_per_row, columns, seed, default_concurrency(),
+				huge_pages ? PagePolicy::Transparent : PagePolicy::Default);
     if (verbose) {
 	auto millis = timer.elapsed().count();
 	cout << fmt::format("dataset created: {}ms", millis) << endl;
@@ -201,6 +220,13 @@ int tool_main(int argc, const char *argv[]) {
 	 [&]() { return radix_mem_index(frame, sort_keys); },
 	 [&](auto index) { return is_sorted(index, frame, sort_keys); });
 
+    // Sort integers packing the key prefix above the row id and refine
+    // runs of equal prefixes using the full keys.
+    measure_sort_indirect<Units>
+	(cout, "packed-index-sort",
+	 [&]() { return packed_index(frame, sort_keys); },
+	 [&](auto index) { return is_sorted(index, frame, sort_keys); });
+
     // {
     // 	auto frame1 = frame.clone();
     // 	measure_sort<Units>
@@ -217,3 +243,12 @@ int tool_main(int argc, const char *argv[]) {
 
     return 0;
 }
+
+int main(int argc, const char *argv[]) {
+    try {
+	return tool_main(argc, argv);
+    } catch (const std::exception& error) {
+	cerr << "sort1: " << error.what() << endl;
+	return 1;
+    }
+}
@@ -5,14 +5,21 @@
 #include <random>
 #include "core/timer/timer.h"
 #include "core/sort/psort_merge.h"
+#include "core/sort/psort_numa.h"
 
 using std::cout, std::endl;
 
 int main(int argc, const char *argv[]) {
     size_t nth = argc < 2 ? 2 : atoi(argv[1]);
     size_t nrecords = argc < 3 ? 100'000'000 : atoi(argv[2]);
+    std::string_view mode = argc < 4 ? "merge" : argv[3];
     
-    if (std::popcount(nth) != 1) {
+    if (mode != "merge" and mode != "numa") {
+	cout << "Mode must be merge or numa: " << mode << endl;
+	return -1;
+    }
+
+    if (mode == "merge" and std::popcount(nth) != 1) {
 	cout << "Number of threads must be power of two: " << nth << endl;
 	return -1;
     }
@@ -25,7 +32,10 @@ int main(int argc, const char *argv[]) {
     core::timer::Timer timer;
     timer.start();
     
-    core::sort::psort_merge(nth, data.begin(), data.end(), std::less{});
+    if (mode == "numa")
+	core::sort::psort_numa(nth, data.begin(), data.end(), std::less{});
+    else
+	core::sort::psort_merge(nth, data.begin(), data.end(), std::less{});
     
     timer.stop();
     cout << (1e-9 * timer.elapsed().count()) << endl;
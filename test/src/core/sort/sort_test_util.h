@@ -0,0 +1,55 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include "core/sort/frame.h"
+#include "core/sort/generate.h"
+#include "core/sort/key.h"
+
+// Reference results and fixtures shared by the sort tests.
+
+using namespace core::sort;
+
+// Return the stable sort index of `frame` by `keys` from
+// `std::stable_sort`.
+auto stable_index(const Frame& frame, const Keys& keys) {
+    std::vector<RowIndex> index(frame.nrows());
+    std::iota(index.begin(), index.end(), 0);
+    std::stable_sort(index.begin(), index.end(), [&](RowIndex a, RowIndex b) {
+	return compare(frame.row(a), frame.row(b), keys);
+    });
+    return index;
+}
+
+auto stable_sorted(const Frame& frame, const Keys& keys) {
+    return frame.order_by(stable_index(frame, keys));
+}
+
+bool same_rows(const Frame& a, const Frame& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Rows with duplicate u8 keys at offset 0 and i32 keys at offset 4
+// that carry their original position in the u32 at offset 12, so that
+// the relative order of equal keys can be checked after sorting.
+auto generate_numbered_rows(size_t nrows, size_t bytes_per_row = 16) {
+    ColumnGenerators columns{
+	{Key{DataType::Unsigned8, 0}, Distribution::Duplicates, 4},
+	{Key{DataType::Signed32, 4}, Distribution::Duplicates, 16},
+    };
+    auto frame = generate_frame(nrows, bytes_per_row, columns, 3);
+    for (uint32_t i = 0; i < nrows; ++i)
+	std::memcpy(frame.row(i) + 12, &i, sizeof(i));
+    return frame;
+}
+
+// The keys of the numbered rows, the i32 descending.
+Keys numbered_keys() {
+    Key i32{DataType::Signed32, 4};
+    i32.order = SortOrder::Descending;
+    return {Key{DataType::Unsigned8, 0}, i32};
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <numeric>
+#include <gtest/gtest.h>
+#include "core/sort/adaptive_sort.h"
+#include "core/sort/generate.h"
+#include "core/sort/sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys{Key{DataType::Unsigned16, 0}};
+
+// Rows carry their original position in the u32 at offset 4 so that
+// stability can be checked.
+auto generate_rows(size_t nrows, Distribution distribution, uint64_t cardinality = 1024) {
+    ColumnGenerators columns{{keys[0], distribution, cardinality, 1.0, 100}};
+    auto frame = generate_frame(nrows, 8, columns, 9);
+    for (uint32_t i = 0; i < nrows; ++i)
+	std::memcpy(frame.row(i) + 4, &i, sizeof(i));
+    return frame;
+}
+
+void check_adaptive(const Frame& frame) {
+    auto expected = stable_sorted(frame, keys);
+    auto copy = frame.clone();
+    adaptive_sort(copy, keys);
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(), expected.begin()));
+}
+
+TEST(Adaptive, Random)
+{
+    for (auto nrows : {0, 1, 2, 31, 33, 1000, 10007})
+	check_adaptive(generate_rows(nrows, Distribution::Duplicates, 50));
+}
+
+TEST(Adaptive, Runs)
+{
+    check_adaptive(generate_rows(10000, Distribution::Runs));
+
+    auto frame = generate_rows(10000, Distribution::Uniform);
+    check_adaptive(stable_sorted(frame, keys));
+
+    // Concatenation of sorted batches, one of them reversed.
+    Frame batches = frame.clone();
+    for (auto begin : {0, 2500, 5000, 7500}) {
+	std::vector<RowIndex> index(2500);
+	std::iota(index.begin(), index.end(), begin);
+	std::stable_sort(index.begin(), index.end(), [&](RowIndex a, RowIndex b) {
+	    return compare(frame.row(a), frame.row(b), keys);
+	});
+	if (begin == 5000)
+	    std::reverse(index.begin(), index.end());
+	for (size_t i = 0; i < index.size(); ++i)
+	    std::copy(frame.row(index[i]), frame.row(index[i] + 1), batches.row(begin + i));
+    }
+    check_adaptive(batches);
+}
+
+TEST(Adaptive, Options)
+{
+    auto frame = generate_rows(5000, Distribution::Runs);
+    auto expected = stable_sorted(frame, keys);
+    sort(frame, keys, {.adaptive = true});
+    EXPECT_TRUE(std::equal(frame.begin(), frame.end(), expected.begin()));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,50 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <numeric>
+#include <gtest/gtest.h>
+#include "core/sort/column_frame.h"
+#include "core/sort/is_sorted.h"
+
+using namespace core::sort;
+
+TEST(ColumnFrame, RoundTrip)
+{
+    Frame frame{1000, 24};
+    auto cframe = ColumnFrame::from_frame(frame, {8, 4, 12});
+    EXPECT_EQ(cframe.ncolumns(), 3);
+    EXPECT_EQ(cframe.bytes_per_row(), 24);
+    auto copy = cframe.to_frame();
+    EXPECT_TRUE(std::equal(frame.begin(), frame.end(), copy.begin()));
+}
+
+TEST(ColumnFrame, Sort)
+{
+    Keys keys{{DataType::Unsigned16, 8}, {DataType::Signed64, 0}};
+    for (auto lazy : {false, true}) {
+	Frame frame{1000, 24};
+	auto cframe = ColumnFrame::from_frame(frame, {8, 4, 12});
+	column_sort(cframe, keys, lazy);
+	EXPECT_EQ(cframe.is_stale(2), lazy);
+
+	std::vector<RowIndex> index(frame.nrows());
+	std::iota(index.begin(), index.end(), 0);
+	std::stable_sort(index.begin(), index.end(), [&](RowIndex a, RowIndex b) {
+	    return compare(frame.row(a), frame.row(b), keys);
+	});
+	auto expected = frame.order_by(index);
+	auto actual = cframe.to_frame();
+	EXPECT_TRUE(std::equal(expected.begin(), expected.end(), actual.begin()));
+
+	column_sort(cframe, Keys{{DataType::Unsigned32, 12}}, lazy);
+	cframe.materialize();
+	EXPECT_FALSE(cframe.is_stale(0));
+	EXPECT_TRUE(is_sorted(cframe.to_frame(), Keys{{DataType::Unsigned32, 12}}));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
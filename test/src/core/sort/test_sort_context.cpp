@@ -0,0 +1,162 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <random>
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/merge_sort.h"
+#include "core/sort/psort_merge.h"
+#include "core/sort/psort_sample.h"
+#include "core/sort/radix_mem_sort_index.h"
+#include "core/sort/radix_msb_sort.h"
+#include "core/sort/radix_sort_index.h"
+#include "core/sort/sort.h"
+#include "core/sort/sort_context.h"
+#include "core/sort/stable_sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys{Key{DataType::Unsigned16, 0}, Key{DataType::Signed32, 4}};
+
+auto generate_rows(size_t nrows, uint64_t seed, size_t bytes_per_row = 16) {
+    ColumnGenerators columns{
+	{keys[0], Distribution::Duplicates, 8},
+	{keys[1], Distribution::Uniform},
+    };
+    return generate_frame(nrows, bytes_per_row, columns, seed);
+}
+
+TEST(Context, ScratchAlignment)
+{
+    SortContext context;
+    auto& a = context.vector<uint8_t>(0);
+    auto& b = context.vector<uint64_t>(7);
+    a.resize(100);
+    b.resize(100);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data()) % 64, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b.data()) % 64, 0);
+    EXPECT_EQ(&context.vector<uint8_t>(0), &a);
+}
+
+TEST(Context, IndexReuse)
+{
+    SortContext context;
+    for (auto nrows : {1000, 0, 5000, 10, 5000}) {
+	auto frame = generate_rows(nrows, nrows + 1);
+	auto expected = radix_index(frame, keys);
+	EXPECT_TRUE(std::ranges::equal(radix_index(frame, keys, context), expected));
+	EXPECT_TRUE(std::ranges::equal(radix_mem_index(frame, keys, context), expected));
+    }
+}
+
+TEST(Context, FrameReuse)
+{
+    SortContext context;
+    for (auto nrows : {1000, 3, 4099, 0, 2000}) {
+	auto frame = generate_rows(nrows, nrows + 2);
+	auto expected = frame.clone();
+	merge_bottom_up(expected, keys);
+
+	auto copy = frame.clone();
+	merge_bottom_up(copy, keys, context);
+	EXPECT_TRUE(same_rows(copy, expected));
+
+	copy = frame.clone();
+	radix_msb_sort(copy, keys, context);
+	EXPECT_TRUE(same_rows(copy, expected));
+
+	copy = frame.clone();
+	stable_merge_sort(copy, keys, context, 4);
+	EXPECT_TRUE(same_rows(copy, expected));
+
+	copy = frame.clone();
+	sort(copy, keys, {.stable = true, .threads = 2, .context = &context});
+	EXPECT_TRUE(same_rows(copy, expected));
+    }
+}
+
+TEST(Context, StableWideReuse)
+{
+    // Both the prefix and the radix index paths of stable sorts of wide
+    // rows take their index and reordered rows from a warm context.
+    const Keys long_keys{keys[0], keys[1], Key{DataType::Unsigned64, 8}};
+    for (const auto& sort_keys : {keys, long_keys}) {
+	SortContext context;
+	const RowIndex *index{};
+	for (auto seed : {1, 2, 3}) {
+	    auto frame = generate_rows(5000, seed, 32);
+	    auto expected = frame.clone();
+	    stable_merge_sort(expected, sort_keys);
+
+	    auto *rows = frame.data(), *scratch = context.frame_like(frame).data();
+	    sort(frame, sort_keys, {.stable = true, .context = &context});
+	    EXPECT_TRUE(same_rows(frame, expected));
+	    EXPECT_EQ(frame.data(), scratch);
+	    EXPECT_EQ(context.frame_like(frame).data(), rows);
+	    if (index) {
+		EXPECT_EQ(context.vector<RowIndex>(1).data(), index);
+	    }
+	    index = context.vector<RowIndex>(1).data();
+	}
+    }
+}
+
+TEST(Context, PagePolicy)
+{
+    auto frame = generate_rows(300000, 5);
+    auto expected = frame.clone();
+    stable_merge_sort(expected, keys, 4);
+
+    SortContext context;
+    for (auto policy : {PagePolicy::Transparent, PagePolicy::Explicit}) {
+	Frame huge(frame.nrows(), frame.bytes_per_row(), false, policy);
+	huge.first_touch(4);
+	std::copy(frame.begin(), frame.end(), huge.begin());
+	huge.first_touch(4, 16);
+	EXPECT_TRUE(same_rows(huge, frame));
+	EXPECT_EQ(huge.empty_clone().policy(), policy);
+#ifdef __linux__
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(huge.data()) % (1 << 21), 0);
+#endif
+
+	auto copy = huge.clone();
+	stable_merge_sort(copy, keys, context, 4);
+	EXPECT_TRUE(same_rows(copy, expected));
+	EXPECT_EQ(copy.policy(), policy);
+
+	copy = huge.clone();
+	radix_msb_sort(copy, keys);
+	EXPECT_TRUE(same_rows(copy, expected));
+
+	huge.resize(10);
+	huge.append(frame);
+	EXPECT_EQ(huge.nrows(), frame.nrows() + 10);
+    }
+}
+
+TEST(Context, ParallelSorts)
+{
+    SortContext context;
+    for (auto n : {1000, 100000}) {
+	std::vector<uint64_t> data(n);
+	std::mt19937_64 rng(n);
+	std::generate(data.begin(), data.end(), rng);
+	auto expected = data;
+	std::sort(expected.begin(), expected.end());
+
+	auto copy = data;
+	psort_merge(4, copy.begin(), copy.end(), std::less{}, context);
+	EXPECT_EQ(copy, expected);
+
+	copy = data;
+	psort_sample(4, copy.begin(), copy.end(), std::less{}, context);
+	EXPECT_EQ(copy, expected);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
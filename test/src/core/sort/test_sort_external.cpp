@@ -0,0 +1,259 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <filesystem>
+#include <numeric>
+#include <gtest/gtest.h>
+#include "core/sort/external_sort.h"
+#include "core/sort/generate.h"
+#include "core/sort/is_sorted.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+namespace fs = std::filesystem;
+
+// Rows carry their original position in the u64 at offset 8 so the
+// order of equal keys can be checked.
+const Schema schema{24, {
+	{"key", DataType::Unsigned16, 0},
+	{"score", DataType::Signed32, 4},
+	{"position", DataType::Unsigned64, 8},
+	{"payload", DataType::Unsigned64, 16},
+    }};
+
+struct ExternalSort : ::testing::Test {
+    void SetUp() override {
+	dir = fs::temp_directory_path() / fmt::format("test_sort_external_{}", ::getpid());
+	fs::create_directories(dir);
+    }
+
+    void TearDown() override {
+	fs::remove_all(dir);
+    }
+
+    std::string path(std::string_view name) const {
+	return (dir / name).string();
+    }
+
+    Frame write_input(size_t nrows, const std::string& input) {
+	ColumnGenerators columns{
+	    {schema.key("key"), Distribution::Duplicates, 50},
+	    {schema.key("score"), Distribution::Duplicates, 4},
+	};
+	auto frame = generate_frame(nrows, schema.bytes_per_row, columns, nrows);
+	for (uint64_t i = 0; i < nrows; ++i)
+	    std::memcpy(frame.row(i) + 8, &i, sizeof(i));
+	write_record_file(input, frame, schema);
+	return frame;
+    }
+
+    fs::path dir;
+};
+
+TEST_F(ExternalSort, InMemory)
+{
+    auto input = path("input"), output = path("output");
+    auto frame = write_input(10000, input);
+    auto keys = schema.keys({"key", "score:desc"});
+
+    auto stats = external_sort(input, output, keys, {.stable = true});
+    EXPECT_EQ(stats.nrows, 10000);
+    EXPECT_EQ(stats.nruns, 0);
+    EXPECT_TRUE(same_rows(read_record_file(output), stable_sorted(frame, keys)));
+    EXPECT_TRUE(same_rows(read_record_file(input), frame));
+    EXPECT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator{}), 2);
+}
+
+TEST_F(ExternalSort, Spill)
+{
+    auto input = path("input"), output = path("output");
+    fs::create_directories(dir / "spill");
+    auto frame = write_input(100003, input);
+    auto keys = schema.keys({"key", "score:desc"});
+    auto expected = stable_sorted(frame, keys);
+
+    for (auto io : {RecordIo::Buffered, RecordIo::Direct}) {
+	// The memory limit allows a fan-in of two, so eleven runs take
+	// four merge passes.
+	ExternalSortOptions options{.stable = true, .threads = 2, .memory_limit = 24 * 20001 * 2,
+	    .spill_dir = (dir / "spill").string(), .io = io};
+	auto stats = external_sort(input, output, keys, options);
+	EXPECT_EQ(stats.nruns, 11);
+	EXPECT_EQ(stats.npasses, 4);
+	EXPECT_TRUE(same_rows(read_record_file(output), expected));
+	EXPECT_TRUE(fs::is_empty(dir / "spill"));
+
+	// Many small runs.
+	options.memory_limit = 24 * 4096 * 2;
+	stats = external_sort(input, output, keys, options);
+	EXPECT_EQ(stats.nruns, 49);
+	EXPECT_EQ(stats.npasses, 6);
+
+	// Sequential stages.
+	options.io_buffers = 1;
+	stats = external_sort(input, output, keys, options);
+	EXPECT_EQ(stats.nruns, 25);
+	EXPECT_TRUE(same_rows(read_record_file(output), expected));
+	EXPECT_TRUE(same_rows(read_record_file(output), expected));
+	EXPECT_TRUE(fs::is_empty(dir / "spill"));
+    }
+}
+
+TEST_F(ExternalSort, Packed)
+{
+    auto input = path("input"), output = path("output");
+    auto frame = write_input(100003, input);
+    auto keys = schema.keys({"key", "score:desc"});
+    auto expected = stable_sorted(frame, keys);
+
+    ExternalSortOptions options{.stable = true, .memory_limit = 24 * 20001 * 2};
+    auto plain = external_sort(input, output, keys, options);
+    options.compression = RecordCompression::Packed;
+    auto packed = external_sort(input, output, keys, options);
+    EXPECT_EQ(packed.nruns, plain.nruns);
+    EXPECT_EQ(packed.npasses, plain.npasses);
+    // Half of each row is random, the rest packs to a few bits.
+    EXPECT_LT(packed.spill_bytes, 3 * plain.spill_bytes / 5);
+    EXPECT_TRUE(same_rows(read_record_file(output), expected));
+    EXPECT_EQ(RecordReader(output).header().compression, RecordCompression::None);
+    EXPECT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator{}), 2);
+}
+
+TEST_F(ExternalSort, Replacement)
+{
+    auto input = path("input"), output = path("output");
+    auto frame = write_input(100003, input);
+    auto keys = schema.keys({"key", "score:desc"});
+    auto expected = stable_sorted(frame, keys);
+
+    ExternalSortOptions options{.stable = true, .memory_limit = 24 * 4096 * 2};
+    auto chunks = external_sort(input, output, keys, options);
+    options.runs = RunGeneration::Replacement;
+    for (auto compression : {RecordCompression::None, RecordCompression::Packed}) {
+	options.compression = compression;
+	auto stats = external_sort(input, output, keys, options);
+	EXPECT_LT(stats.nruns, chunks.nruns / 3);
+	EXPECT_LT(stats.npasses, chunks.npasses);
+	EXPECT_TRUE(same_rows(read_record_file(output), expected));
+	EXPECT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator{}), 2);
+    }
+
+    // Sorted input is a single run.
+    auto stats = external_sort(output, output, keys, options);
+    EXPECT_EQ(stats.nruns, 1);
+    EXPECT_TRUE(same_rows(read_record_file(output), expected));
+}
+
+TEST_F(ExternalSort, InPlace)
+{
+    auto input = path("input");
+    auto frame = write_input(50000, input);
+    auto keys = Keys{schema.key("payload:desc")};
+    auto stats = external_sort(input, input, keys, {.memory_limit = 24 * 8192 * 2});
+    EXPECT_GT(stats.nruns, 1);
+    auto sorted = read_record_file(input);
+    EXPECT_EQ(sorted.nrows(), frame.nrows());
+    EXPECT_TRUE(is_sorted(sorted, keys));
+    EXPECT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator{}), 1);
+}
+
+TEST_F(ExternalSort, Strings)
+{
+    Schema string_schema{16, {{"name", DataType::String, 0}, {"n", DataType::Unsigned64, 8}}};
+    Frame frame(5000, 16, false);
+    for (uint64_t i = 0; i < frame.nrows(); ++i) {
+	frame.set_string(i, 0, fmt::format("name{}", (i * 7919) % 1000));
+	std::memcpy(frame.row(i) + 8, &i, sizeof(i));
+    }
+    auto input = path("input"), output = path("output");
+    write_record_file(input, frame, string_schema);
+
+    auto keys = string_schema.keys({"name", "n"});
+    auto expected = stable_sorted(frame, bind_heap(frame, keys));
+    auto expected_keys = bind_heap(expected, keys);
+    for (auto runs : {RunGeneration::Chunks, RunGeneration::Replacement}) {
+	external_sort(input, output, keys, {.memory_limit = 16 * 512 * 2, .runs = runs});
+	auto sorted = read_record_file(output);
+	auto sorted_keys = bind_heap(sorted, keys);
+	ASSERT_EQ(sorted.nrows(), expected.nrows());
+	for (size_t i = 0; i < sorted.nrows(); ++i)
+	    EXPECT_EQ(compare_rows(sorted.row(i), sorted_keys, expected.row(i), expected_keys), 0);
+    }
+}
+
+TEST_F(ExternalSort, Empty)
+{
+    auto input = path("input"), output = path("output");
+    write_input(0, input);
+    auto stats = external_sort(input, output, schema.keys({"key"}));
+    EXPECT_EQ(stats.nrows, 0);
+    EXPECT_EQ(read_record_file(output).nrows(), 0);
+}
+
+// Return the runs generated from `frame` by replacement selection
+// over `capacity` rows, read in chunks of `chunk_rows`.
+std::vector<Frame> replacement_runs(const Frame& frame, const Keys& keys, size_t capacity,
+				    size_t chunk_rows = 100) {
+    std::vector<Frame> runs;
+    size_t begin{};
+    auto read = [&](Frame& chunk, size_t max_rows) {
+	auto n = std::min({max_rows, chunk_rows, frame.nrows() - begin});
+	chunk = Frame(n, frame.bytes_per_row(), false);
+	std::copy(frame.row(begin), frame.row(begin + n), chunk.begin());
+	begin += n;
+	return n;
+    };
+    auto write = [&](size_t run, const Frame& batch) {
+	EXPECT_LE(run, runs.size());
+	if (run == runs.size())
+	    runs.emplace_back(0, frame.bytes_per_row(), false);
+	runs[run].append(batch);
+    };
+    auto nruns = replacement_selection(capacity, frame.bytes_per_row(), keys, read, write, 64);
+    EXPECT_EQ(nruns, runs.size());
+    return runs;
+}
+
+TEST(ReplacementSelection, Runs)
+{
+    ColumnGenerators columns{{schema.key("key"), Distribution::Uniform, 0}};
+    auto frame = generate_frame(100000, schema.bytes_per_row, columns, 11);
+    for (uint64_t i = 0; i < frame.nrows(); ++i)
+	std::memcpy(frame.row(i) + 8, &i, sizeof(i));
+    auto keys = schema.keys({"key"});
+
+    // Random input gives runs of about twice the capacity. Each run is
+    // sorted with equal keys in input order, and equal keys in later
+    // runs come later in the input.
+    auto runs = replacement_runs(frame, keys, 1000);
+    EXPECT_GE(runs.size(), 45);
+    EXPECT_LE(runs.size(), 55);
+    auto position_keys = schema.keys({"key", "position"});
+    Frame merged(0, schema.bytes_per_row, false);
+    for (const auto& run : runs) {
+	EXPECT_TRUE(is_sorted(run, position_keys));
+	merged.append(run);
+    }
+    ASSERT_EQ(merged.nrows(), frame.nrows());
+    std::vector<RowIndex> index(merged.nrows());
+    std::iota(index.begin(), index.end(), 0);
+    std::stable_sort(index.begin(), index.end(), [&](RowIndex a, RowIndex b) {
+	return compare(merged.row(a), merged.row(b), keys);
+    });
+    EXPECT_TRUE(same_rows(merged.order_by(index), stable_sorted(frame, keys)));
+
+    // Sorted input is one run and reversed input gives runs of the
+    // capacity.
+    auto sorted = stable_sorted(frame, keys);
+    EXPECT_EQ(replacement_runs(sorted, keys, 1000).size(), 1);
+    auto reversed = stable_sorted(frame, schema.keys({"key:desc"}));
+    EXPECT_EQ(replacement_runs(reversed, keys, 1000).size(), 100);
+    EXPECT_EQ(replacement_runs(frame, keys, 1).size(), replacement_runs(frame, keys, 1, 1).size());
+    EXPECT_TRUE(replacement_runs(Frame(0, schema.bytes_per_row, false), keys, 10).empty());
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
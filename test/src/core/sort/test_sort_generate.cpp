@@ -0,0 +1,68 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <set>
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+
+using namespace core::sort;
+
+TEST(Generate, Deterministic)
+{
+    ColumnGenerators columns{{Key{DataType::Unsigned64, 0}}};
+    auto a = generate_frame(1000, 16, columns, 42, 1);
+    auto b = generate_frame(1000, 16, columns, 42, 4);
+    EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin()));
+}
+
+TEST(Generate, Duplicates)
+{
+    ColumnGenerators columns{{Key{DataType::Unsigned32, 4}, Distribution::Duplicates, 10}};
+    auto frame = generate_frame(10000, 8, columns, 1);
+    std::set<uint32_t> values;
+    for (size_t i = 0; i < frame.nrows(); ++i)
+	values.insert(*reinterpret_cast<const uint32_t*>(frame.row(i) + 4));
+    EXPECT_LE(values.size(), 10);
+}
+
+TEST(Generate, Zipf)
+{
+    ColumnGenerators columns{{Key{DataType::Unsigned64, 0}, Distribution::Zipf, 100, 1.2}};
+    auto frame = generate_frame(10000, 8, columns, 1);
+    size_t nzero{};
+    for (size_t i = 0; i < frame.nrows(); ++i) {
+	auto value = *reinterpret_cast<const uint64_t*>(frame.row(i));
+	EXPECT_LT(value, 100);
+	nzero += value == 0;
+    }
+    EXPECT_GT(nzero, frame.nrows() / 10);
+}
+
+TEST(Generate, Runs)
+{
+    ColumnGenerators columns{{Key{DataType::Signed64, 8}, Distribution::Runs, 0, 0, 100}};
+    auto frame = generate_frame(1000, 16, columns, 1);
+    for (size_t i = 1; i < frame.nrows(); ++i) {
+	if (i % 100 == 0)
+	    continue;
+	auto a = *reinterpret_cast<const int64_t*>(frame.row(i - 1) + 8);
+	auto b = *reinterpret_cast<const int64_t*>(frame.row(i) + 8);
+	EXPECT_LE(a, b);
+    }
+}
+
+TEST(Generate, ZeroCardinality)
+{
+    for (auto distribution : {Distribution::Zipf, Distribution::Duplicates}) {
+	ColumnGenerators columns{{Key{DataType::Unsigned64, 0}, distribution, 0}};
+	EXPECT_THROW(generate_frame(100, 8, columns, 1), std::runtime_error);
+    }
+    ColumnGenerators columns{{Key{DataType::Unsigned64, 0}, Distribution::Runs, 0}};
+    EXPECT_NO_THROW(generate_frame(100, 8, columns, 1));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
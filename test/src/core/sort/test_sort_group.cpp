@@ -0,0 +1,62 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/group.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys{Key{DataType::Unsigned16, 0}, Key{DataType::Signed32, 4}};
+
+auto generate_rows(size_t nrows, uint64_t cardinality) {
+    ColumnGenerators columns{
+	{keys[0], Distribution::Duplicates, cardinality},
+	{keys[1], Distribution::Duplicates, 4},
+    };
+    return generate_frame(nrows, 12, columns, 13);
+}
+
+// Return the sorted frame and its group offsets computed separately.
+auto expected_groups(const Frame& frame) {
+    auto sorted = stable_sorted(frame, keys);
+    GroupOffsets offsets;
+    for (size_t i = 0; i < sorted.nrows(); ++i)
+	if (i == 0 or compare(sorted.row(i - 1), sorted.row(i), keys))
+	    offsets.push_back(i);
+    offsets.push_back(sorted.nrows());
+    return std::make_pair(std::move(sorted), offsets);
+}
+
+TEST(Group, SortGroups)
+{
+    for (auto nrows : {0, 1, 16, 17, 1000, 5003}) {
+	for (auto cardinality : {1, 10, 1000}) {
+	    auto frame = generate_rows(nrows, cardinality);
+	    auto [sorted, offsets] = expected_groups(frame);
+	    EXPECT_EQ(sort_groups(frame, keys), offsets);
+	    EXPECT_TRUE(std::equal(frame.begin(), frame.end(), sorted.begin(), sorted.end()));
+	}
+    }
+}
+
+TEST(Group, SortUnique)
+{
+    for (auto nrows : {0, 1, 16, 17, 1000, 5003}) {
+	for (auto cardinality : {1, 10, 1000}) {
+	    auto frame = generate_rows(nrows, cardinality);
+	    auto [sorted, offsets] = expected_groups(frame);
+	    sort_unique(frame, keys);
+	    ASSERT_EQ(frame.nrows() + 1, offsets.size());
+	    for (size_t i = 0; i < frame.nrows(); ++i)
+		EXPECT_TRUE(std::equal(frame.row(i), frame.row(i + 1), sorted.row(offsets[i])));
+	}
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <thread>
+#include <gtest/gtest.h>
+#include "core/sort/incremental_sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+using namespace std::chrono_literals;
+
+const Keys keys = numbered_keys();
+
+TEST(Incremental, Steps)
+{
+    for (auto engine : {IncrementalEngine::Merge, IncrementalEngine::Radix}) {
+	for (auto nrows : {0, 1, 2, 3, 1000, 4097}) {
+	    for (auto budget : {1, 7, 100, 100000}) {
+		auto frame = generate_numbered_rows(nrows);
+		auto expected = stable_sorted(frame, keys);
+		IncrementalSort sorter(frame, keys, engine);
+		auto total = sorter.progress().total;
+		size_t steps{}, done{};
+		while (sorter.step(budget) == SortStatus::Running) {
+		    auto progress = sorter.progress();
+		    EXPECT_EQ(progress.total, total);
+		    EXPECT_LE(progress.done, done + budget);
+		    EXPECT_GT(progress.done, done);
+		    done = progress.done;
+		    ++steps;
+		}
+		EXPECT_EQ(sorter.status(), SortStatus::Done);
+		EXPECT_EQ(sorter.progress().done, total);
+		EXPECT_EQ(sorter.progress().fraction(), 1.0);
+		EXPECT_GE(steps + 1, total / budget);
+		EXPECT_TRUE(same_rows(frame, expected));
+		EXPECT_EQ(sorter.step(budget), SortStatus::Done);
+	    }
+	}
+    }
+}
+
+TEST(Incremental, TimeSlices)
+{
+    for (auto engine : {IncrementalEngine::Merge, IncrementalEngine::Radix}) {
+	auto frame = generate_numbered_rows(200000);
+	auto expected = stable_sorted(frame, keys);
+	IncrementalSort sorter(frame, keys, engine);
+	size_t slices{};
+	while (sorter.run_for(100us, 64) == SortStatus::Running)
+	    ++slices;
+	EXPECT_GT(slices, 0);
+	EXPECT_TRUE(same_rows(frame, expected));
+    }
+}
+
+TEST(Incremental, Cancel)
+{
+    auto frame = generate_numbered_rows(10000), original = frame;
+
+    // A cancelled radix sort leaves the frame unchanged.
+    IncrementalSort radix(frame, keys, IncrementalEngine::Radix);
+    EXPECT_EQ(radix.step(radix.progress().total - 1), SortStatus::Running);
+    radix.cancel();
+    EXPECT_EQ(radix.step(100), SortStatus::Cancelled);
+    EXPECT_EQ(radix.progress().done, radix.progress().total - 1);
+    EXPECT_TRUE(same_rows(frame, original));
+
+    // A cancelled merge sort leaves the same rows in some order.
+    IncrementalSort merge(frame, keys);
+    std::thread canceller([&]() { merge.cancel(); });
+    canceller.join();
+    EXPECT_EQ(merge.run(), SortStatus::Cancelled);
+    auto position = Keys{Key{DataType::Unsigned32, 12}};
+    EXPECT_TRUE(same_rows(stable_sorted(frame, position), original));
+}
+
+TEST(Incremental, Strings)
+{
+    Frame frame(3000, 16, false);
+    for (uint64_t i = 0; i < frame.nrows(); ++i) {
+	frame.set_string(i, 0, fmt::format("name{}", (i * 7919) % 1000));
+	std::memcpy(frame.row(i) + 8, &i, sizeof(i));
+    }
+    Keys string_keys{Key{DataType::String, 0}};
+    auto expected = stable_sorted(frame, bind_heap(frame, string_keys));
+    IncrementalSort sorter(frame, string_keys);
+    EXPECT_EQ(sorter.run(), SortStatus::Done);
+    EXPECT_TRUE(same_rows(frame, expected));
+    EXPECT_THROW(IncrementalSort(frame, string_keys, IncrementalEngine::Radix), std::runtime_error);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <numeric>
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/join.h"
+
+using namespace core::sort;
+
+// The left frame has the join key at offset 0 and the right frame at
+// offset 4 so the keys differ.
+const Keys left_keys{Key{DataType::Signed32, 0}};
+const Keys right_keys{Key{DataType::Signed32, 4}};
+
+auto generate_side(size_t nrows, const Keys& keys, uint64_t seed) {
+    ColumnGenerators columns{{keys[0], Distribution::Duplicates, 300}};
+    return generate_frame(nrows, 12, columns, seed);
+}
+
+// Nested loop join ordered like merge_join: by key and then by row id.
+JoinPairs nested_join(const Frame& left, const Frame& right, JoinType type) {
+    std::vector<RowIndex> order(left.nrows());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](RowIndex a, RowIndex b) {
+	return compare(left.row(a), left.row(b), left_keys);
+    });
+
+    JoinPairs pairs;
+    for (auto ldx : order) {
+	std::vector<RowIndex> matches;
+	for (size_t rdx = 0; rdx < right.nrows(); ++rdx)
+	    if (compare_rows(left.row(ldx), left_keys, right.row(rdx), right_keys) == 0)
+		matches.push_back(rdx);
+	if (matches.empty() and type == JoinType::Left)
+	    pairs.push_back({ldx, JoinPair::NoRow});
+	else if (not matches.empty() and type == JoinType::Semi)
+	    pairs.push_back({ldx, matches.front()});
+	else if (type != JoinType::Semi)
+	    for (auto rdx : matches)
+		pairs.push_back({ldx, rdx});
+    }
+    return pairs;
+}
+
+TEST(Join, Types)
+{
+    auto left = generate_side(2000, left_keys, 1), right = generate_side(1500, right_keys, 2);
+    for (auto type : {JoinType::Inner, JoinType::Left, JoinType::Semi}) {
+	auto expected = nested_join(left, right, type);
+	for (auto nth : {1, 4})
+	    EXPECT_EQ(merge_join(left, left_keys, right, right_keys, type, nth), expected);
+    }
+}
+
+TEST(Join, Nulls)
+{
+    auto left = generate_side(500, left_keys, 3), right = generate_side(500, right_keys, 4);
+    Key lkey = left_keys[0], rkey = right_keys[0];
+    lkey.null_source = rkey.null_source = NullSource::Sentinel;
+    lkey.sentinel = rkey.sentinel = *reinterpret_cast<const uint32_t*>(left.row(0));
+    std::memcpy(right.row(0) + 4, left.row(0), sizeof(int32_t));
+
+    auto pairs = merge_join(left, {lkey}, right, {rkey}, JoinType::Left);
+    for (const auto& pair : pairs)
+	EXPECT_TRUE(not lkey.is_null(left.row(pair.left)) or pair.right == JoinPair::NoRow);
+    EXPECT_THROW(merge_join(left, {lkey}, right, {Key{DataType::Signed64, 4}}), std::runtime_error);
+}
+
+TEST(Join, Rows)
+{
+    auto left = generate_side(100, left_keys, 5), right = generate_side(100, right_keys, 6);
+    auto pairs = merge_join(left, left_keys, right, right_keys, JoinType::Left);
+    auto rows = join_rows(left, right, pairs);
+    ASSERT_EQ(rows.nrows(), pairs.size());
+    EXPECT_EQ(rows.bytes_per_row(), 24);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+	EXPECT_TRUE(std::equal(left.row(pairs[i].left), left.row(pairs[i].left + 1), rows.row(i)));
+	if (pairs[i].right != JoinPair::NoRow) {
+	    auto rptr = right.row(pairs[i].right);
+	    EXPECT_TRUE(std::equal(rptr, rptr + 12, rows.row(i) + 12));
+	}
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,163 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <random>
+#include <sstream>
+#include <gtest/gtest.h>
+#include "core/sort/column_frame.h"
+#include "core/sort/generate.h"
+#include "core/sort/is_sorted.h"
+#include "core/sort/radix_mem_sort_index.h"
+#include "core/sort/radix_msb_sort.h"
+#include "core/sort/radix_sort_index.h"
+#include "core/sort/std_sort_index.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+void check_engines(const Frame& frame, const Keys& keys,
+		   const std::vector<size_t>& widths = {1, 1, 2, 4, 8}) {
+    auto expected = stable_index(frame, keys);
+    auto copy = frame.clone();
+    EXPECT_EQ(radix_index(copy, keys), expected);
+    EXPECT_EQ(radix_mem_index(copy, keys), expected);
+
+    auto cframe = ColumnFrame::from_frame(frame, widths);
+    EXPECT_EQ(column_sort_index(cframe, keys), expected);
+
+    auto sorted = frame.order_by(expected);
+    radix_msb_sort(copy, keys);
+    EXPECT_TRUE(std::equal(sorted.begin(), sorted.end(), copy.begin()));
+}
+
+auto generate_keys(size_t nrows) {
+    ColumnGenerators columns{
+	{Key{DataType::Unsigned8, 1}, Distribution::Duplicates, 4},
+	{Key{DataType::Unsigned16, 2}, Distribution::Duplicates, 8},
+	{Key{DataType::Signed64, 8}, Distribution::Duplicates, 16}
+    };
+    return generate_frame(nrows, 16, columns, 7);
+}
+
+TEST(Keys, Descending)
+{
+    auto frame = generate_keys(2000);
+    Key u16{DataType::Unsigned16, 2}, i64{DataType::Signed64, 8};
+    i64.order = SortOrder::Descending;
+    check_engines(frame, {i64});
+    check_engines(frame, {u16, i64});
+    u16.order = SortOrder::Descending;
+    i64.order = SortOrder::Ascending;
+    check_engines(frame, {u16, i64});
+}
+
+TEST(Keys, Nulls)
+{
+    auto frame = generate_keys(2000);
+    for (auto nulls : {NullOrder::First, NullOrder::Last}) {
+	Key bitmap{DataType::Signed64, 8};
+	bitmap.null_source = NullSource::Bitmap;
+	bitmap.validity_bit = 3;
+	bitmap.nulls = nulls;
+	bitmap.order = SortOrder::Descending;
+	check_engines(frame, {bitmap, Key{DataType::Unsigned16, 2}});
+
+	Key sentinel{DataType::Unsigned16, 2};
+	sentinel.null_source = NullSource::Sentinel;
+	sentinel.sentinel = *reinterpret_cast<const uint16_t*>(frame.row(0) + 2);
+	sentinel.nulls = nulls;
+	check_engines(frame, {sentinel, Key{DataType::Unsigned8, 1}});
+    }
+}
+
+TEST(Keys, Types)
+{
+    ColumnGenerators columns{
+	{Key{DataType::Signed8, 0}, Distribution::Duplicates, 8},
+	{Key{DataType::Signed16, 2}, Distribution::Duplicates, 8},
+	{Key{DataType::Signed32, 4}, Distribution::Duplicates, 8},
+	{Key{DataType::Signed128, 8}, Distribution::Duplicates, 8},
+	{Key{DataType::Unsigned128, 24}}
+    };
+    auto frame = generate_frame(2000, 40, columns, 11);
+
+    // Replace the 128-bit values so that their high words differ and
+    // repeat: Signed128 values lie within 8 of -2, -1, 0 or 1 times 2^64
+    // and Unsigned128 high words are ~0, 0 or 1.
+    std::mt19937_64 rng(11);
+    for (size_t i = 0; i < frame.nrows(); ++i) {
+	auto high = static_cast<__int128>(rng() % 4) - 2;
+	auto value = high * (__int128{1} << 64) + static_cast<int64_t>(rng() % 16) - 8;
+	auto uvalue = static_cast<unsigned __int128>(rng() % 3 - 1) << 64 | rng();
+	std::memcpy(frame.row(i) + 8, &value, sizeof(value));
+	std::memcpy(frame.row(i) + 24, &uvalue, sizeof(uvalue));
+    }
+
+    std::vector<size_t> widths{1, 1, 2, 4, 16, 16};
+    for (const auto& column : columns)
+	check_engines(frame, {column.key}, widths);
+
+    Keys keys{columns[0].key, columns[1].key, columns[2].key, columns[3].key};
+    keys[1].order = SortOrder::Descending;
+    check_engines(frame, keys, widths);
+
+    for (auto type : {"i8", "i16", "i32", "i128", "u128"}) {
+	std::stringstream ss;
+	ss << core::str::lexical_cast<DataType>(type);
+	EXPECT_EQ(ss.str(), type);
+    }
+}
+
+TEST(Keys, IndexType)
+{
+    auto frame = generate_keys(1000);
+    Keys keys{Key{DataType::Unsigned16, 2}, Key{DataType::Signed64, 8}};
+    auto expected = stable_index(frame, keys);
+    std::vector<uint64_t> expected64(expected.begin(), expected.end());
+    EXPECT_EQ(radix_index<uint64_t>(frame, keys), expected64);
+    EXPECT_EQ(radix_mem_index<uint64_t>(frame, keys), expected64);
+    EXPECT_TRUE(is_sorted(std_sort_index<uint64_t>(frame, keys), frame, keys));
+}
+
+TEST(Keys, Prefetch)
+{
+    auto frame = generate_keys(3000);
+    Keys keys{Key{DataType::Signed64, 8}, Key{DataType::Unsigned8, 1}};
+    auto expected = stable_index(frame, keys);
+    for (auto prefetch : {0, 1, 64, 10000}) {
+	EXPECT_EQ(radix_index(frame, keys, prefetch), expected);
+	EXPECT_EQ(radix_mem_index(frame, keys, prefetch), expected);
+    }
+}
+
+TEST(Keys, LongKey)
+{
+    Key fixed{DataType::FixedString, 0, 1000};
+    ColumnGenerators columns{{fixed, Distribution::Duplicates, 16}};
+    auto frame = generate_frame(500, 1008, columns, 19);
+    Keys keys{fixed, Key{DataType::Unsigned64, 1000}};
+    auto expected = stable_index(frame, keys);
+    EXPECT_EQ(radix_index(frame, keys), expected);
+    EXPECT_EQ(radix_mem_index(frame, keys), expected);
+}
+
+TEST(Keys, Parse)
+{
+    auto key = core::str::lexical_cast<Key>("i64:8:desc:nulls_first:valid=3");
+    EXPECT_EQ(key.type, DataType::Signed64);
+    EXPECT_EQ(key.offset, 8);
+    EXPECT_TRUE(key.descending());
+    EXPECT_EQ(key.nulls, NullOrder::First);
+    EXPECT_EQ(key.null_source, NullSource::Bitmap);
+    EXPECT_EQ(key.validity_bit, 3);
+
+    key = core::str::lexical_cast<Key>("u32:4:sentinel=0");
+    EXPECT_FALSE(key.descending());
+    EXPECT_EQ(key.null_source, NullSource::Sentinel);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
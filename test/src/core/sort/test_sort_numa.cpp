@@ -0,0 +1,111 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <gtest/gtest.h>
+#include "core/sort/psort_numa.h"
+#include "core/sort/sort_context.h"
+#include "core/sort/topology.h"
+
+using namespace core::sort;
+namespace fs = std::filesystem;
+
+// Write `content` to `path` creating the parent directories.
+void write_file(const fs::path& path, std::string_view content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+TEST(Numa, ParseCpuList)
+{
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(parse_cpu_list("5"), std::vector<int>{5});
+    EXPECT_TRUE(parse_cpu_list("").empty());
+    EXPECT_THROW(parse_cpu_list("0-x"), std::runtime_error);
+}
+
+TEST(Numa, ReadTopology)
+{
+    auto root = fs::temp_directory_path() / fmt::format("test_sort_numa_{}", ::getpid());
+    fs::remove_all(root);
+    write_file(root / "node" / "node0" / "cpulist", "0-1,4-5\n");
+    write_file(root / "node" / "node1" / "cpulist", "2-3,6-7\n");
+    write_file(root / "node" / "node2" / "cpulist", "\n");
+    write_file(root / "node" / "online", "0-2\n");
+
+    auto topology = Topology::read(root);
+    ASSERT_EQ(topology.nodes.size(), 2);
+    EXPECT_EQ(topology.nodes[0].id, 0);
+    EXPECT_EQ(topology.nodes[1].cpus, (std::vector<int>{2, 3, 6, 7}));
+    EXPECT_EQ(topology.ncpus(), 8);
+
+    topology = Topology::read(root, {1, 2, 3});
+    ASSERT_EQ(topology.nodes.size(), 2);
+    EXPECT_EQ(topology.nodes[0].cpus, std::vector<int>{1});
+
+    fs::remove_all(root / "node");
+    write_file(root / "cpu" / "cpu0" / "topology" / "physical_package_id", "0\n");
+    write_file(root / "cpu" / "cpu1" / "topology" / "physical_package_id", "1\n");
+    write_file(root / "cpu" / "cpu2" / "topology" / "physical_package_id", "0\n");
+    write_file(root / "cpu" / "cpufreq" / "x", "");
+    topology = Topology::read(root);
+    ASSERT_EQ(topology.nodes.size(), 2);
+    EXPECT_EQ(topology.nodes[0].cpus, (std::vector<int>{0, 2}));
+    EXPECT_EQ(topology.nodes[1].cpus, std::vector<int>{1});
+
+    fs::remove_all(root);
+    EXPECT_GE(Topology::read(root).ncpus(), 1);
+    EXPECT_GE(Topology::system().ncpus(), 1);
+}
+
+TEST(Numa, Sort)
+{
+    // Two fake nodes of four cpus each backed by whatever cpus are
+    // available.
+    std::vector<int> cpus;
+    for (auto i = 0; i < 4; ++i)
+	cpus.push_back(Topology::system().nodes[0].cpus[i % Topology::system().nodes[0].cpus.size()]);
+    Topology topology{{{0, cpus}, {1, cpus}}};
+    EXPECT_EQ(psort_detail::numa_workers(topology, 3).size(), 3);
+    EXPECT_EQ(psort_detail::numa_workers(topology, 20).size(), 8);
+    SortContext context;
+    for (auto n : {0, 1, 1000, 100000, 250001}) {
+	for (auto modulus : {uint64_t{3}, uint64_t{0}}) {
+	    std::vector<uint64_t> data(n);
+	    std::mt19937_64 rng(n);
+	    for (auto& value : data)
+		value = modulus ? rng() % modulus : rng();
+	    auto expected = data;
+	    std::sort(expected.begin(), expected.end());
+
+	    for (auto nth : {1, 3, 8}) {
+		auto copy = data;
+		psort_numa(nth, copy.begin(), copy.end(), std::less{}, topology);
+		EXPECT_EQ(copy, expected);
+
+		copy = data;
+		psort_numa(nth, copy.begin(), copy.end(), std::less{}, context, topology);
+		EXPECT_EQ(copy, expected);
+	    }
+	}
+    }
+}
+
+TEST(Numa, Descending)
+{
+    std::vector<int> data(200000);
+    std::mt19937 rng(1);
+    std::generate(data.begin(), data.end(), [&]() { return int(rng() % 1000); });
+    auto expected = data;
+    std::sort(expected.begin(), expected.end(), std::greater{});
+    psort_numa(4, data.begin(), data.end(), std::greater{});
+    EXPECT_EQ(data, expected);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/packed_sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+auto generate_rows(size_t nrows) {
+    ColumnGenerators columns{
+	{Key{DataType::Unsigned16, 0}, Distribution::Duplicates, 8},
+	{Key{DataType::Signed32, 4}, Distribution::Duplicates, 100},
+	{Key{DataType::Unsigned64, 8}, Distribution::Duplicates, 1000},
+    };
+    return generate_frame(nrows, 16, columns, 17);
+}
+
+TEST(Packed, Exact)
+{
+    // 48 key bits fit in the prefix so no refinement is needed.
+    auto frame = generate_rows(5000);
+    Keys keys{Key{DataType::Unsigned16, 0}, Key{DataType::Signed32, 4}};
+    keys[1].order = SortOrder::Descending;
+    EXPECT_EQ(packed_index(frame, keys), stable_index(frame, keys));
+    EXPECT_EQ(packed_index<unsigned __int128>(frame, keys), stable_index(frame, keys));
+}
+
+TEST(Packed, Refine)
+{
+    for (auto nrows : {0, 1, 2, 100, 5000}) {
+	auto frame = generate_rows(nrows);
+	Keys keys{Key{DataType::Unsigned16, 0}, Key{DataType::Signed32, 4},
+		  Key{DataType::Unsigned64, 8}};
+	keys[2].null_source = NullSource::Bitmap;
+	keys[2].validity_bit = 70;
+	auto expected = stable_index(frame, keys);
+	EXPECT_EQ(packed_index(frame, keys), expected);
+	EXPECT_EQ(packed_index<unsigned __int128>(frame, keys), expected);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/partial_sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys{Key{DataType::Unsigned16, 0}, Key{DataType::Unsigned32, 4}};
+
+auto generate_rows(size_t nrows) {
+    ColumnGenerators columns{
+	{keys[0], Distribution::Duplicates, 64},
+	{keys[1], Distribution::Duplicates, 64},
+    };
+    return generate_frame(nrows, 16, columns, 5);
+}
+
+bool equal_keys(const uint8_t *a, const uint8_t *b) {
+    return not compare(a, b, keys) and not compare(b, a, keys);
+}
+
+// Sorted copy of all rows so that reordering can be checked to be a
+// permutation of the original frame.
+auto all_rows(const Frame& frame) {
+    std::vector<std::vector<uint8_t>> rows;
+    for (size_t i = 0; i < frame.nrows(); ++i)
+	rows.emplace_back(frame.row(i), frame.row(i + 1));
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+TEST(Partial, TopKIndex)
+{
+    auto frame = generate_rows(20000);
+    auto expected = stable_index(frame, keys);
+    for (auto k : {0, 1, 10, 1000}) {
+	std::vector<RowIndex> prefix(expected.begin(), expected.begin() + k);
+	for (auto nth : {1, 4})
+	    EXPECT_EQ(top_k_index(frame, keys, k, nth), prefix);
+    }
+}
+
+TEST(Partial, PartialSort)
+{
+    auto frame = generate_rows(10000);
+    auto sorted = frame.order_by(stable_index(frame, keys));
+    for (size_t k : {1, 100, 5000, 10000}) {
+	for (auto nth : {1, 4}) {
+	    auto copy = frame.clone();
+	    partial_sort(copy, keys, k, nth);
+	    for (size_t i = 0; i < k; ++i)
+		EXPECT_TRUE(equal_keys(copy.row(i), sorted.row(i)));
+	    for (auto i = k; i < copy.nrows(); ++i)
+		EXPECT_FALSE(compare(copy.row(i), copy.row(k - 1), keys));
+	    EXPECT_EQ(all_rows(copy), all_rows(frame));
+	}
+    }
+}
+
+TEST(Partial, NthElement)
+{
+    auto frame = generate_rows(10000);
+    auto sorted = frame.order_by(stable_index(frame, keys));
+    for (size_t kdx : {0, 17, 4999, 9999}) {
+	auto copy = frame.clone();
+	nth_element(copy, keys, kdx);
+	EXPECT_TRUE(equal_keys(copy.row(kdx), sorted.row(kdx)));
+	for (size_t i = 0; i < kdx; ++i)
+	    EXPECT_FALSE(compare(copy.row(kdx), copy.row(i), keys));
+	for (auto i = kdx + 1; i < copy.nrows(); ++i)
+	    EXPECT_FALSE(compare(copy.row(i), copy.row(kdx), keys));
+    }
+
+    Frame empty{0, frame.bytes_per_row(), false};
+    nth_element(empty, keys, 0);
+    EXPECT_EQ(empty.nrows(), 0);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/pipeline.h"
+#include "core/sort/record_file.h"
+
+using namespace core::sort;
+namespace fs = std::filesystem;
+
+const Schema schema{16, {{"id", DataType::Unsigned64, 0}, {"value", DataType::Unsigned64, 8}}};
+
+struct PipelineFile : ::testing::Test {
+    void SetUp() override {
+	path = (fs::temp_directory_path() / fmt::format("test_sort_pipeline_{}", ::getpid())).string();
+	frame = generate_frame(10007, schema.bytes_per_row, {}, 1);
+	for (uint64_t i = 0; i < frame.nrows(); ++i)
+	    std::memcpy(frame.row(i), &i, sizeof(i));
+	write_record_file(path, frame, schema);
+    }
+
+    void TearDown() override {
+	fs::remove(path);
+    }
+
+    std::string path;
+    Frame frame{0, 16, false};
+};
+
+TEST_F(PipelineFile, Order)
+{
+    for (auto nbuffers : {1, 2, 3, 7, 100}) {
+	RecordReader reader(path);
+	Frame out(0, schema.bytes_per_row, false);
+	size_t nprocessed{};
+	pipeline_chunks(reader, 1000, [&](Frame& chunk) {
+	    // Tag the chunk so the writer can check it was processed.
+	    for (size_t i = 0; i < chunk.nrows(); ++i)
+		chunk.row(i)[15] ^= 0xff;
+	    ++nprocessed;
+	}, [&](const Frame& chunk) {
+	    out.append(chunk);
+	}, nbuffers);
+
+	EXPECT_EQ(nprocessed, 11);
+	ASSERT_EQ(out.nrows(), frame.nrows());
+	for (size_t i = 0; i < out.nrows(); ++i)
+	    out.row(i)[15] ^= 0xff;
+	EXPECT_TRUE(std::equal(out.begin(), out.end(), frame.begin(), frame.end()));
+    }
+}
+
+TEST_F(PipelineFile, Errors)
+{
+    for (auto stage : {1, 2}) {
+	RecordReader reader(path);
+	size_t nwritten{};
+	auto run = [&]() {
+	    pipeline_chunks(reader, 100, [&](Frame& chunk) {
+		if (stage == 1 and *reinterpret_cast<const uint64_t*>(chunk.row(0)) == 500)
+		    throw std::runtime_error("process");
+	    }, [&](const Frame& chunk) {
+		if (stage == 2 and *reinterpret_cast<const uint64_t*>(chunk.row(0)) == 300)
+		    throw std::runtime_error("write");
+		++nwritten;
+	    });
+	};
+	EXPECT_THROW(run(), std::runtime_error);
+	EXPECT_LE(nwritten, stage == 1 ? 5 : 3);
+    }
+
+    fs::resize_file(path, RecordAlign + 100 * schema.bytes_per_row);
+    RecordReader reader(path);
+    EXPECT_THROW(pipeline_chunks(reader, 1000, [](Frame&) {}, [](const Frame&) {}), std::runtime_error);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "core/sort/array_ring.h"
+#include "core/sort/mpmc_queue.h"
+#include "core/sort/spsc_queue.h"
+
+using namespace core::sort;
+
+TEST(Queue, ArrayRing)
+{
+    ArrayRing<int, 3, 8> ring;
+    for (auto i = 0; i < 10; ++i) {
+	ring.push_back(i);
+	EXPECT_EQ(ring.back(), i);
+	if (ring.size() == 3) {
+	    EXPECT_EQ(ring.pop_front(), i - 2);
+	}
+    }
+    EXPECT_EQ(ring.front(), 8);
+    EXPECT_EQ(ring.pop_back(), 9);
+    EXPECT_EQ(ring[ring.tail_index()], 8);
+
+    static_assert(ArrayRing<int, 8, 8>::slot(13) == 5);
+    static_assert(ArrayRing<int, 6, 8>::slot(13) == 1);
+    ArrayRing<int, 8, 8> padded;
+    EXPECT_GE(reinterpret_cast<uintptr_t>(&padded.tail_index()) - reinterpret_cast<uintptr_t>(&padded.head_index()), 64);
+}
+
+template<class Queue>
+void check_full_empty(Queue& queue, size_t size) {
+    size_t value;
+    EXPECT_FALSE(queue.try_pop(value));
+    for (size_t i = 0; i < size; ++i)
+	EXPECT_TRUE(queue.try_push(i));
+    EXPECT_FALSE(queue.try_push(size));
+    for (size_t i = 0; i < size; ++i) {
+	EXPECT_TRUE(queue.try_pop(value));
+	EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(Queue, Spsc)
+{
+    SpscQueue<size_t, 4> queue;
+    check_full_empty(queue, 4);
+    SpscQueue<size_t, 5> odd;
+    check_full_empty(odd, 5);
+
+    constexpr size_t Count = 1'000'000;
+    SpscQueue<size_t, 64> transport;
+    std::thread producer([&]() {
+	for (size_t i = 0; i < Count; ++i)
+	    while (not transport.try_push(i))
+		std::this_thread::yield();
+    });
+    size_t value, expected{};
+    while (expected < Count) {
+	if (transport.try_pop(value)) EXPECT_EQ(value, expected++);
+	else std::this_thread::yield();
+    }
+    producer.join();
+}
+
+TEST(Queue, Mpmc)
+{
+    MpmcQueue<size_t, 8> queue;
+    check_full_empty(queue, 8);
+    check_full_empty(queue, 8);
+
+    // Every value pushed by each producer is popped exactly once and
+    // each consumer sees the values of a producer in order.
+    constexpr size_t NumberProducers = 3, NumberConsumers = 3, Count = 200'000;
+    MpmcQueue<size_t, 64> transport;
+    std::vector<std::thread> threads;
+    for (size_t pid = 0; pid < NumberProducers; ++pid)
+	threads.emplace_back([&, pid]() {
+	    for (size_t i = 0; i < Count; ++i)
+		while (not transport.try_push(pid * Count + i))
+		    std::this_thread::yield();
+	});
+
+    std::vector<std::vector<size_t>> popped(NumberConsumers);
+    std::atomic<size_t> remaining{NumberProducers * Count};
+    for (size_t cid = 0; cid < NumberConsumers; ++cid)
+	threads.emplace_back([&, cid]() {
+	    size_t value;
+	    while (remaining.load() > 0) {
+		if (transport.try_pop(value)) {
+		    popped[cid].push_back(value);
+		    --remaining;
+		} else {
+		    std::this_thread::yield();
+		}
+	    }
+	});
+    for (auto& thread : threads)
+	thread.join();
+
+    std::vector<size_t> all;
+    for (const auto& values : popped) {
+	std::vector<size_t> last(NumberProducers);
+	for (auto value : values) {
+	    auto pid = value / Count;
+	    EXPECT_TRUE(last[pid] == 0 or value > last[pid]);
+	    last[pid] = value;
+	}
+	all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(all.size(), NumberProducers * Count);
+    for (size_t i = 0; i < all.size(); ++i)
+	EXPECT_EQ(all[i], i);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
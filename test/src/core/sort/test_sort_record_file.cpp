@@ -0,0 +1,242 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/is_sorted.h"
+#include "core/sort/radix_sort_index.h"
+#include "core/sort/record_file.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+namespace fs = std::filesystem;
+
+const Schema schema{24, {
+	{"id", DataType::Unsigned64, 0},
+	{"score", DataType::Signed32, 8},
+	{"tag", DataType::FixedString, 12, 4},
+	{"pad", DataType::Unsigned64, 16},
+    }};
+
+std::string temp_path(std::string_view name) {
+    return (fs::temp_directory_path() / fmt::format("test_sort_record_{}_{}", ::getpid(), name)).string();
+}
+
+TEST(RecordFile, RoundTrip)
+{
+    auto path = temp_path("round_trip");
+    for (auto nrows : {0, 1, 1000, 200000}) {
+	for (auto io : {RecordIo::Buffered, RecordIo::Direct}) {
+	    auto frame = generate_frame(nrows, schema.bytes_per_row, {}, nrows);
+	    write_record_file(path, frame, schema, io);
+	    EXPECT_EQ(fs::file_size(path), RecordAlign + nrows * schema.bytes_per_row);
+
+	    Schema read_schema;
+	    auto copy = read_record_file(path, &read_schema, io);
+	    EXPECT_EQ(read_schema, schema);
+	    EXPECT_TRUE(same_rows(copy, frame));
+
+	    MappedRecordFile mapped(path);
+	    EXPECT_EQ(mapped.schema(), schema);
+	    EXPECT_EQ(mapped.nrows(), nrows);
+	    EXPECT_TRUE(std::equal(mapped.begin(), mapped.end(), frame.begin(), frame.end()));
+	    EXPECT_TRUE(same_rows(mapped.frame(), frame));
+	}
+    }
+    fs::remove(path);
+}
+
+TEST(RecordFile, Streaming)
+{
+    auto path = temp_path("streaming");
+    auto frame = generate_frame(100003, schema.bytes_per_row, {}, 7);
+    for (auto io : {RecordIo::Buffered, RecordIo::Direct}) {
+	{
+	    RecordWriter writer(path, schema, io, 5000);
+	    for (size_t begin = 0; begin < frame.nrows(); begin += 777) {
+		Frame chunk(std::min<size_t>(777, frame.nrows() - begin), schema.bytes_per_row, false);
+		std::copy(frame.row(begin), frame.row(begin + chunk.nrows()), chunk.begin());
+		writer.write(chunk);
+	    }
+	    EXPECT_EQ(writer.nrows(), frame.nrows());
+	}
+
+	RecordReader reader(path, io, 8192);
+	EXPECT_EQ(reader.header().nrows, frame.nrows());
+	Frame chunk(0, schema.bytes_per_row, false);
+	size_t idx{};
+	while (auto n = reader.read(chunk, 1000)) {
+	    EXPECT_EQ(n, chunk.nrows());
+	    EXPECT_TRUE(std::equal(chunk.begin(), chunk.end(), frame.row(idx)));
+	    idx += n;
+	}
+	EXPECT_EQ(idx, frame.nrows());
+	EXPECT_EQ(reader.remaining(), 0);
+    }
+    fs::remove(path);
+}
+
+TEST(RecordFile, Strings)
+{
+    auto path = temp_path("strings");
+    Schema string_schema{16, {{"name", DataType::String, 0}, {"n", DataType::Unsigned64, 8}}};
+    std::vector<std::string> names{"pear", "apple", "", "banana", "fig"};
+
+    RecordWriter writer(path, string_schema);
+    for (size_t batch = 0; batch < 2; ++batch) {
+	Frame frame(names.size(), 16, false);
+	for (size_t i = 0; i < names.size(); ++i) {
+	    frame.set_string(i, 0, names[i] + std::to_string(batch));
+	    uint64_t n = batch * 10 + i;
+	    std::memcpy(frame.row(i) + 8, &n, sizeof(n));
+	}
+	writer.write(frame);
+    }
+    writer.close();
+
+    auto check = [&](const Frame& frame) {
+	ASSERT_EQ(frame.nrows(), 2 * names.size());
+	auto key = bind_heap(frame, {string_schema.key("name")}).front();
+	for (size_t i = 0; i < frame.nrows(); ++i)
+	    EXPECT_EQ(string_value(frame.row(i), key), names[i % names.size()] + std::to_string(i / names.size()));
+    };
+    check(read_record_file(path));
+    check(MappedRecordFile(path).frame());
+
+    RecordReader reader(path);
+    Frame chunk(0, 16, false);
+    reader.read(chunk, 3);
+    reader.read(chunk, 3);
+    auto key = bind_heap(chunk, {string_schema.key("name")}).front();
+    EXPECT_EQ(string_value(chunk.row(0), key), "banana0");
+    fs::remove(path);
+}
+
+TEST(RecordFile, KeysByName)
+{
+    auto key = schema.key("score:desc:nulls_first:sentinel=5");
+    EXPECT_EQ(key.type, DataType::Signed32);
+    EXPECT_EQ(key.offset, 8);
+    EXPECT_TRUE(key.descending());
+    EXPECT_EQ(key.nulls, NullOrder::First);
+    EXPECT_EQ(key.sentinel, 5);
+    EXPECT_EQ(schema.key("tag").width, 4);
+    EXPECT_EQ(schema.keys({"id", "tag"}).size(), 2);
+    EXPECT_THROW(schema.key("missing"), std::runtime_error);
+    EXPECT_THROW(schema.key("id:sideways"), std::runtime_error);
+
+    auto path = temp_path("keys");
+    auto frame = generate_frame(5000, schema.bytes_per_row, {}, 3);
+    write_record_file(path, frame, schema);
+    Schema read_schema;
+    auto copy = read_record_file(path, &read_schema);
+    auto keys = read_schema.keys({"tag", "score:desc"});
+    copy = copy.order_by(radix_index(copy, keys));
+    EXPECT_TRUE(is_sorted(copy, keys));
+    fs::remove(path);
+}
+
+TEST(RecordFile, Packed)
+{
+    auto path = temp_path("packed");
+    for (auto nrows : {0, 1, 1000, 200000}) {
+	for (auto io : {RecordIo::Buffered, RecordIo::Direct}) {
+	    auto frame = generate_frame(nrows, schema.bytes_per_row, {}, nrows);
+	    auto keys = schema.keys({"id"});
+	    frame = frame.order_by(radix_index(frame, keys));
+	    write_record_file(path, frame, schema, io, RecordCompression::Packed);
+
+	    RecordReader reader(path, io, 8192);
+	    EXPECT_EQ(reader.header().compression, RecordCompression::Packed);
+	    Frame chunk(0, schema.bytes_per_row, false);
+	    size_t idx{};
+	    while (auto n = reader.read(chunk, 777)) {
+		EXPECT_TRUE(std::equal(chunk.begin(), chunk.end(), frame.row(idx)));
+		idx += n;
+	    }
+	    EXPECT_EQ(idx, frame.nrows());
+	    EXPECT_TRUE(same_rows(read_record_file(path, nullptr, io), frame));
+	    EXPECT_THROW(MappedRecordFile{path}, std::runtime_error);
+	}
+    }
+
+    // A sorted key, a narrow signed column and constant bytes pack well
+    // below half the size of the rows; random bytes are stored as is.
+    auto frame = generate_frame(100000, schema.bytes_per_row, {}, 5);
+    for (uint64_t i = 0; i < frame.nrows(); ++i) {
+	uint64_t id = 1'000'000 + 3 * i;
+	int32_t score = int32_t(i % 100) - 50;
+	std::memcpy(frame.row(i), &id, sizeof(id));
+	std::memcpy(frame.row(i) + 8, &score, sizeof(score));
+	std::memcpy(frame.row(i) + 12, "abcd", 4);
+    }
+    write_record_file(path, frame, schema, RecordIo::Buffered, RecordCompression::Packed);
+    EXPECT_LT(fs::file_size(path), RecordAlign + frame.nrows() * schema.bytes_per_row / 2);
+    EXPECT_TRUE(same_rows(read_record_file(path), frame));
+    fs::remove(path);
+}
+
+TEST(RecordFile, PackedStrings)
+{
+    auto path = temp_path("packed_strings");
+    Schema wide_schema{40, {
+	    {"name", DataType::String, 0},
+	    {"big", DataType::Signed128, 8},
+	    {"small", DataType::Signed8, 24},
+	    {"u", DataType::Unsigned64, 32},
+	}};
+    Frame frame(20000, 40, false);
+    for (uint64_t i = 0; i < frame.nrows(); ++i) {
+	std::fill(frame.row(i), frame.row(i + 1), 0);
+	frame.set_string(i, 0, fmt::format("name{}", i % 37));
+	__int128 big = (i % 2 ? -1 : 1) * (__int128(i) << 70);
+	int8_t small = i % 2 ? INT8_MIN : INT8_MAX;
+	uint64_t u = UINT64_MAX - i / 1000;
+	std::memcpy(frame.row(i) + 8, &big, sizeof(big));
+	std::memcpy(frame.row(i) + 24, &small, sizeof(small));
+	std::memcpy(frame.row(i) + 32, &u, sizeof(u));
+    }
+    write_record_file(path, frame, wide_schema, RecordIo::Buffered, RecordCompression::Packed);
+    auto copy = read_record_file(path);
+    ASSERT_EQ(copy.nrows(), frame.nrows());
+    auto key = bind_heap(copy, {wide_schema.key("name")}).front();
+    for (size_t i = 0; i < copy.nrows(); ++i) {
+	EXPECT_EQ(string_value(copy.row(i), key), fmt::format("name{}", i % 37));
+	EXPECT_TRUE(std::equal(copy.row(i) + 8, copy.row(i + 1), frame.row(i) + 8));
+    }
+    fs::remove(path);
+}
+
+TEST(RecordFile, Errors)
+{
+    auto path = temp_path("errors");
+    EXPECT_THROW(RecordReader("/nonexistent/record/file"), std::runtime_error);
+    std::ofstream(path) << "not a record file at all, not a record file at all, not a record file";
+    EXPECT_THROW(RecordReader{path}, std::runtime_error);
+    EXPECT_THROW(MappedRecordFile{path}, std::runtime_error);
+
+    auto frame = generate_frame(100, schema.bytes_per_row, {}, 1);
+    write_record_file(path, frame, schema);
+    fs::resize_file(path, RecordAlign + 10 * schema.bytes_per_row);
+    EXPECT_THROW(MappedRecordFile{path}, std::runtime_error);
+    RecordReader reader(path);
+    Frame chunk(0, schema.bytes_per_row, false);
+    EXPECT_THROW(reader.read(chunk, 100), std::runtime_error);
+
+    write_record_file(path, frame, schema, RecordIo::Buffered, RecordCompression::Packed);
+    fs::resize_file(path, RecordAlign + (fs::file_size(path) - RecordAlign) / 2);
+    RecordReader packed(path);
+    EXPECT_THROW(packed.read(chunk, 100), std::runtime_error);
+
+    RecordWriter writer(path, schema);
+    EXPECT_THROW(writer.write(Frame(1, 8, false)), std::runtime_error);
+    fs::remove(path);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
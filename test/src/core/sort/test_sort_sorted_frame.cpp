@@ -0,0 +1,60 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/generate.h"
+#include "core/sort/merge_sort.h"
+#include "core/sort/sorted_frame.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys{Key{DataType::Signed32, 0}};
+
+auto generate_batch(size_t nrows, uint64_t seed) {
+    ColumnGenerators columns{{keys[0], Distribution::Duplicates, 100}};
+    return generate_frame(nrows, 12, columns, seed);
+}
+
+TEST(SortedFrame, Merge)
+{
+    auto a = stable_sorted(generate_batch(500, 1), keys), b = stable_sorted(generate_batch(700, 2), keys);
+    auto all = a.clone();
+    all.append(b);
+    auto expected = stable_sorted(all, keys);
+    auto merged = merge(a, b, keys);
+    EXPECT_TRUE(std::equal(merged.begin(), merged.end(), expected.begin(), expected.end()));
+}
+
+TEST(SortedFrame, Append)
+{
+    SortedFrame sorted(12, keys, 100);
+    Frame all(0, 12, false);
+    for (auto i = 0; i < 50; ++i) {
+	auto batch = generate_batch(1 + 7 * i % 61, i);
+	sorted.append(batch);
+	all.append(batch);
+	EXPECT_EQ(sorted.nrows(), all.nrows());
+	EXPECT_LE(sorted.nlevels(), 1 + std::bit_width(sorted.nrows()));
+
+	if (i % 10 == 9) {
+	    auto expected = stable_sorted(all, keys);
+	    EXPECT_TRUE(std::equal(sorted.begin(), sorted.end(), expected.begin(), expected.end()));
+	    EXPECT_EQ(sorted.nlevels(), 1);
+	}
+    }
+}
+
+TEST(SortedFrame, Empty)
+{
+    SortedFrame sorted(12, keys);
+    EXPECT_EQ(sorted.nrows(), 0);
+    EXPECT_EQ(sorted.begin(), sorted.end());
+    EXPECT_THROW(sorted.append(Frame(1, 8)), std::runtime_error);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/merge_sort.h"
+#include "core/sort/sort.h"
+#include "core/sort/stable_sort.h"
+#include "sort_test_util.h"
+
+using namespace core::sort;
+
+const Keys keys = numbered_keys();
+
+TEST(Stable, MergeSort)
+{
+    for (auto nrows : {0, 1, 15, 17, 1000, 4099}) {
+	auto frame = generate_numbered_rows(nrows, 16);
+	auto expected = stable_sorted(frame, keys);
+	for (auto nth : {1, 3, 8}) {
+	    auto copy = frame.clone();
+	    stable_merge_sort(copy, keys, nth);
+	    EXPECT_TRUE(same_rows(copy, expected));
+	}
+	merge_bottom_up(frame, keys);
+	EXPECT_TRUE(same_rows(frame, expected));
+    }
+}
+
+TEST(Stable, PrefixIndex)
+{
+    auto frame = generate_numbered_rows(2000, 16);
+    auto expected = stable_sorted(frame, keys);
+    EXPECT_TRUE(same_rows(frame.order_by(stable_prefix_index(frame, keys)), expected));
+
+    Keys wide{keys[0], Key{DataType::Unsigned64, 4}};
+    expected = stable_sorted(frame, wide);
+    EXPECT_TRUE(same_rows(frame.order_by(stable_prefix_index(frame, wide)), expected));
+}
+
+TEST(Stable, Options)
+{
+    for (auto bytes_per_row : {16, 64}) {
+	auto frame = generate_numbered_rows(3000, bytes_per_row);
+	auto expected = stable_sorted(frame, keys);
+	for (auto threads : {1, 4}) {
+	    auto copy = frame.clone();
+	    sort(copy, keys, {.stable = true, .threads = size_t(threads)});
+	    EXPECT_TRUE(same_rows(copy, expected));
+
+	    copy = frame.clone();
+	    sort(copy, keys, {.threads = size_t(threads)});
+	    for (size_t i = 1; i < copy.nrows(); ++i)
+		EXPECT_FALSE(compare(copy.row(i), copy.row(i - 1), keys));
+	}
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
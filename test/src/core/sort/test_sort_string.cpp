@@ -0,0 +1,161 @@
+// Copyright (C) 2022, 2023 by Mark Melton
+//
+
+#include <gtest/gtest.h>
+#include "core/sort/group.h"
+#include "core/sort/is_sorted.h"
+#include "core/sort/merge_sort.h"
+#include "core/sort/partial_sort.h"
+#include "core/sort/radix_sort_index.h"
+#include "core/sort/sort.h"
+#include "core/sort/sorted_frame.h"
+#include "core/sort/string_sort.h"
+
+using namespace core::sort;
+
+auto generate_strings(size_t nrows) {
+    Frame frame{nrows, 24};
+    std::mt19937_64 rng;
+    std::uniform_int_distribution<int> length(0, 20), letter('a', 'd');
+    for (size_t i = 0; i < nrows; ++i) {
+	std::string str(length(rng), ' ');
+	for (auto& c : str)
+	    c = letter(rng);
+	frame.set_string(i, 0, str);
+	std::fill(frame.row(i) + 8, frame.row(i) + 16, 0);
+	std::copy(str.begin(), str.begin() + std::min<size_t>(str.size(), 8), frame.row(i) + 8);
+    }
+    return frame;
+}
+
+TEST(StringSort, String)
+{
+    auto frame = generate_strings(5000);
+    Keys keys = bind_heap(frame, {{DataType::String, 0}, {DataType::Unsigned32, 16}});
+    EXPECT_TRUE(is_sorted(multikey_quick_sort_index(frame, keys), frame, keys));
+    EXPECT_TRUE(is_sorted(string_radix_index(frame, keys), frame, keys));
+    EXPECT_TRUE(is_sorted(string_prefix_index(frame, keys), frame, keys));
+}
+
+TEST(StringSort, FixedString)
+{
+    auto frame = generate_strings(5000);
+    Keys keys{{DataType::FixedString, 8, 8}, {DataType::Unsigned64, 16}};
+    EXPECT_TRUE(is_sorted(multikey_quick_sort_index(frame, keys), frame, keys));
+    EXPECT_TRUE(is_sorted(string_radix_index(frame, keys), frame, keys));
+    EXPECT_TRUE(is_sorted(string_prefix_index(frame, keys), frame, keys));
+    EXPECT_TRUE(is_sorted(radix_index(frame, keys), frame, keys));
+}
+
+TEST(StringSort, DescendingNulls)
+{
+    auto frame = generate_strings(5000);
+    Key key{DataType::String, 0};
+    key.order = SortOrder::Descending;
+    key.null_source = NullSource::Bitmap;
+    key.validity_bit = 8 * 16;
+    for (auto nulls : {NullOrder::First, NullOrder::Last}) {
+	key.nulls = nulls;
+	Keys keys = bind_heap(frame, {key, {DataType::Unsigned32, 20}});
+	EXPECT_TRUE(is_sorted(multikey_quick_sort_index(frame, keys), frame, keys));
+	EXPECT_TRUE(is_sorted(string_radix_index(frame, keys), frame, keys));
+	EXPECT_TRUE(is_sorted(string_prefix_index(frame, keys), frame, keys));
+    }
+}
+
+TEST(StringSort, BinaryBytes)
+{
+    // Bytes 0, 1, 2 and 0xff, including NUL, in both directions, with
+    // strings of every length so that prefixes and ends are compared.
+    const uint8_t alphabet[] = {0x00, 0x01, 0x02, 0xff};
+    Frame frame{5000, 24};
+    std::mt19937_64 rng;
+    std::uniform_int_distribution<int> length(0, 8), letter(0, 3);
+    for (size_t i = 0; i < frame.nrows(); ++i) {
+	std::string str(length(rng), ' ');
+	for (auto& c : str)
+	    c = char(alphabet[letter(rng)]);
+	frame.set_string(i, 0, str);
+	std::fill(frame.row(i) + 8, frame.row(i) + 16, 0);
+	std::copy(str.begin(), str.end(), frame.row(i) + 8);
+	uint64_t position = i;
+	std::memcpy(frame.row(i) + 16, &position, sizeof(position));
+    }
+
+    for (auto order : {SortOrder::Ascending, SortOrder::Descending}) {
+	for (auto key : {Key{DataType::FixedString, 8, 8}, Key{DataType::String, 0}}) {
+	    key.order = order;
+	    Keys keys = bind_heap(frame, {key, {DataType::Unsigned64, 16}});
+	    EXPECT_TRUE(is_sorted(multikey_quick_sort_index(frame, keys), frame, keys));
+	    EXPECT_TRUE(is_sorted(string_radix_index(frame, keys), frame, keys));
+	    EXPECT_TRUE(is_sorted(string_prefix_index(frame, keys), frame, keys));
+	}
+    }
+}
+
+TEST(StringSort, Unbound)
+{
+    // The engines bind String keys to the heap of the frame they sort.
+    const auto input = generate_strings(5000);
+    const Keys keys{{DataType::String, 0}, {DataType::Unsigned32, 16}};
+    auto check = [&](auto&& sort_frame) {
+	auto frame = input;
+	sort_frame(frame);
+	EXPECT_TRUE(is_sorted(frame, keys));
+    };
+    for (auto options : {SortOptions{}, SortOptions{.stable = true}, SortOptions{.adaptive = true},
+			 SortOptions{.threads = 2}})
+	check([&](Frame& frame) { sort(frame, keys, options); });
+    check([&](Frame& frame) { adaptive_sort(frame, keys); });
+    check([&](Frame& frame) { stable_merge_sort(frame, keys); });
+    check([&](Frame& frame) { merge_bottom_up(frame, keys); });
+    check([&](Frame& frame) { quick_block_sort(frame, keys); });
+    check([&](Frame& frame) { quick_sort(frame, keys); });
+    check([&](Frame& frame) { sort_groups(frame, keys); });
+    check([&](Frame& frame) { partial_sort(frame, keys, frame.nrows()); });
+    check([&](Frame& frame) {
+	partial_sort(frame, keys, 100);
+	frame.resize(100);
+    });
+
+    SortedFrame sorted(input.bytes_per_row(), keys, 512);
+    for (size_t begin = 0; begin < input.nrows(); begin += 700) {
+	auto end = std::min<size_t>(begin + 700, input.nrows());
+	Frame batch(end - begin, input.bytes_per_row(), false);
+	batch.share_heap(input);
+	std::copy(input.row(begin), input.row(end), batch.begin());
+	sorted.append(batch);
+    }
+    EXPECT_EQ(sorted.nrows(), input.nrows());
+    EXPECT_TRUE(is_sorted(sorted.frame(), keys));
+
+    auto other = generate_strings(10);
+    EXPECT_THROW(merge(input, other, keys), std::runtime_error);
+    EXPECT_THROW(sorted.append(other), std::runtime_error);
+    EXPECT_EQ(sorted.nrows(), input.nrows());
+}
+
+TEST(StringSort, RefOverflow)
+{
+    constexpr size_t Max = std::numeric_limits<uint32_t>::max();
+    auto ref = make_string_ref(Max, Max);
+    EXPECT_EQ(ref.offset, Max);
+    EXPECT_EQ(ref.length, Max);
+    EXPECT_THROW(make_string_ref(Max + 1, 0), std::runtime_error);
+    EXPECT_THROW(make_string_ref(0, Max + 1), std::runtime_error);
+}
+
+TEST(StringSort, Parse)
+{
+    auto key = core::str::lexical_cast<Key>("c16:8");
+    EXPECT_EQ(key.type, DataType::FixedString);
+    EXPECT_EQ(key.width, 16);
+    EXPECT_EQ(key.offset, 8);
+    EXPECT_EQ(core::str::lexical_cast<Key>("str:0").type, DataType::String);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}